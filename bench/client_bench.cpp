@@ -0,0 +1,288 @@
+// End-to-end client throughput and latency against an in-process WFS mock
+// server on loopback.
+//
+// Each benchmark takes the connection count as its last argument: the
+// benchmark threads share that many clients (thread i uses client
+// i % connections), so 16 threads on 1 connection measure contention on a
+// single session while 16 on 16 measure parallel sessions. items_per_second
+// is ops/s, bytes_per_second the payload throughput, and p50_us/p99_us/
+// p999_us the per-call latency taken from the clients' own histograms.
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "wfs_client/iwfs_client.hpp"
+#include "wfs_mock_server.hpp"
+
+using namespace wfs_client;
+
+namespace
+{
+
+  // Large enough for the 256 MB payloads plus framing
+  constexpr int kMaxMessageSize = 512 * 1024 * 1024;
+
+  WfsMockServerOptions ServerOptions()
+  {
+    WfsMockServerOptions options;
+    options.maxMessageSize = kMaxMessageSize;
+    return options;
+  }
+
+  WfsMockServer &Server()
+  {
+    static WfsMockServer server(ServerOptions());
+    return server;
+  }
+
+  // Clients of the current run, opened by Setup before any thread starts
+  std::vector<std::shared_ptr<IWfsClient>> g_clients;
+
+  WfsConnectionParams ClientParams()
+  {
+    WfsConnectionParams params("127.0.0.1", Server().Port());
+    params.maxMessageSize = kMaxMessageSize;
+    params.receiveTimeout = 120000;
+    params.sendTimeout = 120000;
+    return params;
+  }
+
+  void OpenClients(size_t count, const WfsConnectionParams &params = ClientParams())
+  {
+    g_clients.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+      std::shared_ptr<IWfsClient> client;
+      if (!CreateWfsClient(client, params, WfsAuthInfo("bench", "bench")))
+      {
+        throw std::runtime_error("cannot connect to the mock server");
+      }
+      g_clients.push_back(std::move(client));
+    }
+  }
+
+  void CloseClients(const benchmark::State &)
+  {
+    g_clients.clear();
+  }
+
+  IWfsClient &ClientFor(const benchmark::State &state)
+  {
+    return *g_clients[static_cast<size_t>(state.thread_index()) % g_clients.size()];
+  }
+
+  std::string FilePath(const char *kind, int64_t bytes, int thread)
+  {
+    return fmt::format("/bench/{}/{}/{}", kind, bytes, thread);
+  }
+
+  // Latency percentiles over every client of the run; reported once, by
+  // thread 0, after all threads left the timed loop
+  void ReportLatency(benchmark::State &state, WfsOpType op)
+  {
+    if (state.thread_index() != 0)
+    {
+      return;
+    }
+    WfsLatencyHistogram latency;
+    for (const auto &client : g_clients)
+    {
+      latency.Merge(client->GetMetrics().Op(op).latency);
+    }
+    state.counters["p50_us"] = static_cast<double>(latency.Percentile(0.5));
+    state.counters["p99_us"] = static_cast<double>(latency.Percentile(0.99));
+    state.counters["p999_us"] = static_cast<double>(latency.Percentile(0.999));
+  }
+
+  // 1 KB .. 4 MB payloads, over 1 and 4 connections
+  void SmallPayloads(benchmark::internal::Benchmark *bench)
+  {
+    bench->ArgNames({"bytes", "connections"})
+        ->ArgsProduct({benchmark::CreateRange(1 << 10, 4 << 20, 16), {1, 4}});
+  }
+
+  // 64 MB and 256 MB payloads, single-threaded to keep memory bounded
+  void LargePayloads(benchmark::internal::Benchmark *bench)
+  {
+    bench->ArgNames({"bytes", "connections"})
+        ->Args({int64_t{64} << 20, 1})
+        ->Args({int64_t{256} << 20, 1});
+  }
+
+  void ThreadCounts(benchmark::internal::Benchmark *bench)
+  {
+    bench->Threads(1)->Threads(4)->Threads(16);
+  }
+
+} // namespace
+
+static void UploadSetup(const benchmark::State &state)
+{
+  OpenClients(static_cast<size_t>(state.range(1)));
+}
+
+static void BM_Upload(benchmark::State &state)
+{
+  const int64_t bytes = state.range(0);
+  IWfsClient &client = ClientFor(state);
+  const WfsFileData file(FilePath("put", bytes, state.thread_index()), std::string(static_cast<size_t>(bytes), 'u'));
+  for (auto _ : state)
+  {
+    if (!client.UploadFile(file))
+    {
+      state.SkipWithError("upload failed");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * bytes);
+  ReportLatency(state, WfsOpType::Append);
+}
+BENCHMARK(BM_Upload)->Apply(SmallPayloads)->Apply(ThreadCounts)->Setup(UploadSetup)->Teardown(CloseClients)->UseRealTime();
+BENCHMARK(BM_Upload)->Apply(LargePayloads)->Setup(UploadSetup)->Teardown(CloseClients)->UseRealTime();
+
+static void DownloadSetup(const benchmark::State &state)
+{
+  const int64_t bytes = state.range(0);
+  for (int thread = 0; thread < state.threads(); ++thread)
+  {
+    Server().Put(FilePath("get", bytes, thread), std::string(static_cast<size_t>(bytes), 'd'));
+  }
+  OpenClients(static_cast<size_t>(state.range(1)));
+}
+
+// Each thread reads its own path, so concurrent downloads are not coalesced
+static void BM_Download(benchmark::State &state)
+{
+  const int64_t bytes = state.range(0);
+  IWfsClient &client = ClientFor(state);
+  const std::string path = FilePath("get", bytes, state.thread_index());
+  std::shared_ptr<const std::string> data;
+  for (auto _ : state)
+  {
+    if (!client.DownloadFileShared(path, data))
+    {
+      state.SkipWithError("download failed");
+      break;
+    }
+    data.reset();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * bytes);
+  ReportLatency(state, WfsOpType::Get);
+}
+BENCHMARK(BM_Download)->Apply(SmallPayloads)->Apply(ThreadCounts)->Setup(DownloadSetup)->Teardown(CloseClients)->UseRealTime();
+BENCHMARK(BM_Download)->Apply(LargePayloads)->Setup(DownloadSetup)->Teardown(CloseClients)->UseRealTime();
+
+static void ListSetup(const benchmark::State &state)
+{
+  const int64_t entries = state.range(0);
+  for (int thread = 0; thread < state.threads(); ++thread)
+  {
+    for (int64_t i = 0; i < entries; ++i)
+    {
+      Server().Put(fmt::format("/bench/list/{}/{}/file{}", entries, thread, i), std::string(64, 'l'));
+    }
+  }
+  OpenClients(static_cast<size_t>(state.range(1)));
+}
+
+static void BM_List(benchmark::State &state)
+{
+  IWfsClient &client = ClientFor(state);
+  const std::string dir = fmt::format("/bench/list/{}/{}", state.range(0), state.thread_index());
+  WfsDirList listing;
+  for (auto _ : state)
+  {
+    if (!client.ListDirectory(dir, listing))
+    {
+      state.SkipWithError("listing failed");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  ReportLatency(state, WfsOpType::List);
+}
+BENCHMARK(BM_List)
+    ->ArgNames({"entries", "connections"})
+    ->ArgsProduct({{16, 1024}, {1, 4}})
+    ->Apply(ThreadCounts)
+    ->Setup(ListSetup)
+    ->Teardown(CloseClients)
+    ->UseRealTime();
+
+static void PingSetup(const benchmark::State &state)
+{
+  OpenClients(static_cast<size_t>(state.range(0)));
+}
+
+static void BM_Ping(benchmark::State &state)
+{
+  IWfsClient &client = ClientFor(state);
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(client.Ping());
+  }
+  state.SetItemsProcessed(state.iterations());
+  ReportLatency(state, WfsOpType::Ping);
+}
+BENCHMARK(BM_Ping)
+    ->ArgName("connections")
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(16)
+    ->Apply(ThreadCounts)
+    ->Setup(PingSetup)
+    ->Teardown(CloseClients)
+    ->UseRealTime();
+
+// 4 KB uploads over a simulated WAN link: one round trip per upload
+// (writeBehind 0) against pipelined write-behind batches (writeBehind 1)
+static void WanUploadSetup(const benchmark::State &state)
+{
+  WfsConnectionParams params = ClientParams();
+  params.networkSimulation.enabled = true;
+  params.networkSimulation.rttMicros = state.range(0);
+  params.networkSimulation.jitterMicros = state.range(0) / 10;
+  params.networkSimulation.bandwidthBytesPerSecond = 12500000; // 100 Mbit/s
+  params.writeBehind = state.range(1) != 0;
+  OpenClients(1, params);
+}
+
+static void BM_UploadWan(benchmark::State &state)
+{
+  IWfsClient &client = ClientFor(state);
+  WfsFileData file(std::string(), std::string(4096, 'w'));
+  int64_t uploaded = 0;
+  for (auto _ : state)
+  {
+    // Distinct paths, write-behind would coalesce repeated uploads of one
+    file.name = fmt::format("/bench/wan/{}", uploaded++);
+    bool ok = client.UploadFile(file).ok;
+    if (ok && uploaded % 256 == 0)
+    {
+      ok = client.Flush().ok;
+    }
+    if (!ok)
+    {
+      state.SkipWithError("upload failed");
+      break;
+    }
+  }
+  client.Flush();
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * 4096);
+}
+BENCHMARK(BM_UploadWan)
+    ->ArgNames({"rtt_us", "writeBehind"})
+    ->ArgsProduct({{1000, 20000}, {0, 1}})
+    ->Setup(WanUploadSetup)
+    ->Teardown(CloseClients)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
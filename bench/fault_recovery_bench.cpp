@@ -0,0 +1,144 @@
+// Time-to-recovery and retry cost of the client under injected faults.
+//
+// Each iteration breaks a healthy connection in one way and then retries
+// the upload until it succeeds; the client reconnects and re-authenticates
+// on its own. The iteration time is the time from the first failing call to
+// that success. wasted_bytes are the request/reply bytes cut short by the
+// fault, attempts the upload calls needed.
+//
+//   drop_mid_upload  connection reset halfway through a 64 KB upload
+//   reply_timeout    the upload reply never arrives (receive timeout 250 ms)
+//   corrupt_reply    the upload reply is garbled
+//   refuse_connect   Reconnect() and the next 2 transparent reconnects refused
+//   auth_retry       connection reset during Authenticate (retried on a new connection)
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "wfs_client/fault_injection.hpp"
+#include "wfs_client/iwfs_client.hpp"
+#include "wfs_mock_server.hpp"
+
+using namespace wfs_client;
+
+namespace
+{
+
+  enum Scenario
+  {
+    kDropMidUpload,
+    kReplyTimeout,
+    kCorruptReply,
+    kRefuseConnect,
+    kAuthRetry
+  };
+
+  const char *const kScenarioNames[] = {"drop_mid_upload", "reply_timeout", "corrupt_reply",
+                                        "refuse_connect", "auth_retry"};
+
+  constexpr size_t kUploadBytes = 64 * 1024;
+
+  // A client that never recovers fails the run instead of hanging it
+  constexpr uint64_t kMaxAttempts = 20;
+
+  WfsMockServer &Server()
+  {
+    static WfsMockServer server;
+    return server;
+  }
+
+  const WfsAuthInfo kAuth("bench", "bench");
+
+} // namespace
+
+static void BM_FaultRecovery(benchmark::State &state)
+{
+  const auto scenario = static_cast<Scenario>(state.range(0));
+  state.SetLabel(kScenarioNames[scenario]);
+
+  std::shared_ptr<IWfsFaultInjector> injector;
+  CreateWfsFaultInjector(injector);
+
+  WfsConnectionParams params("127.0.0.1", Server().Port());
+  params.receiveTimeout = 250;
+  params.faultInjector = injector;
+
+  std::shared_ptr<IWfsClient> client;
+  if (!CreateWfsClient(client, params, kAuth))
+  {
+    state.SkipWithError("cannot connect to the mock server");
+    return;
+  }
+
+  const WfsFileData file("/bench/fault/file", std::string(kUploadBytes, 'f'));
+  uint64_t attempts = 0;
+  const uint64_t wastedBefore = injector->Stats().wastedBytes;
+
+  for (auto _ : state)
+  {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start;
+
+    switch (scenario)
+    {
+    case kDropMidUpload:
+      injector->Arm(WfsFaultType::DropConnection, kUploadBytes / 2);
+      start = Clock::now();
+      break;
+    case kReplyTimeout:
+      injector->Arm(WfsFaultType::Timeout);
+      start = Clock::now();
+      break;
+    case kCorruptReply:
+      injector->Arm(WfsFaultType::CorruptFrame);
+      start = Clock::now();
+      break;
+    case kRefuseConnect:
+      injector->Arm(WfsFaultType::RefuseConnect, 0, 3);
+      start = Clock::now();
+      client->Reconnect();
+      break;
+    case kAuthRetry:
+      client->Disconnect();
+      client->Reconnect();
+      injector->Arm(WfsFaultType::DropConnection);
+      start = Clock::now();
+      client->Authenticate(kAuth);
+      break;
+    }
+
+    uint64_t iterationAttempts = 0;
+    bool recovered = false;
+    while (!recovered && iterationAttempts < kMaxAttempts)
+    {
+      ++iterationAttempts;
+      recovered = client->UploadFile(file);
+    }
+    attempts += iterationAttempts;
+    if (!recovered)
+    {
+      injector->Disarm();
+      state.SkipWithError("upload did not recover");
+      break;
+    }
+
+    state.SetIterationTime(std::chrono::duration<double>(Clock::now() - start).count());
+    injector->Disarm();
+  }
+
+  const double iterations = static_cast<double>(state.iterations());
+  state.counters["wasted_bytes"] = static_cast<double>(injector->Stats().wastedBytes - wastedBefore) / iterations;
+  state.counters["attempts"] = static_cast<double>(attempts) / iterations;
+}
+BENCHMARK(BM_FaultRecovery)
+    ->ArgName("scenario")
+    ->DenseRange(kDropMidUpload, kAuthRetry)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(10);
+
+BENCHMARK_MAIN();
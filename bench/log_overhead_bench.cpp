@@ -0,0 +1,102 @@
+// Per-call cost of client log statements.
+//
+// The hot path (e.g. a successful download) logs at Debug. With the default
+// runtime level (Warn) that statement must cost next to nothing; the other
+// cases show what enabling it costs with the async ring buffer logger and
+// with the previous unconditional colored fmt::print.
+
+#include <benchmark/benchmark.h>
+#include <fmt/color.h>
+
+#include <cstdio>
+#include <string>
+
+#include "wfs_log.hpp"
+
+using namespace wfs_client;
+
+namespace
+{
+
+  const std::string kPath = "bucket/objects/status.json";
+  const size_t kBytes = 4096;
+
+  // Sink that discards everything, isolates the logger's own cost
+  class NullLogger : public IWfsLogger
+  {
+  public:
+    void Log(WfsLogLevel, std::string_view message) override
+    {
+      benchmark::DoNotOptimize(message.data());
+    }
+  };
+
+  FILE *OpenNullDevice()
+  {
+#ifdef _WIN32
+    return fopen("NUL", "w");
+#else
+    return fopen("/dev/null", "w");
+#endif
+  }
+
+} // namespace
+
+// Default configuration: Debug statement, runtime level Warn
+static void BM_LogDisabledAtRuntime(benchmark::State &state)
+{
+  SetWfsLogLevel(WfsLogLevel::Warn);
+  for (auto _ : state)
+  {
+    WFS_LOG_DEBUG("File download successful: {} ({} bytes)", kPath, kBytes);
+  }
+}
+BENCHMARK(BM_LogDisabledAtRuntime);
+
+// Enabled Debug statement through the async ring buffer logger
+static void BM_LogAsyncRingBuffer(benchmark::State &state)
+{
+  std::shared_ptr<IWfsLogger> logger;
+  CreateWfsAsyncLogger(logger, std::make_shared<NullLogger>(), 1 << 16);
+  SetWfsLogger(logger);
+  SetWfsLogLevel(WfsLogLevel::Debug);
+  for (auto _ : state)
+  {
+    WFS_LOG_DEBUG("File download successful: {} ({} bytes)", kPath, kBytes);
+  }
+  SetWfsLogLevel(WfsLogLevel::Warn);
+  logger->Flush();
+  std::shared_ptr<IWfsLogger> console;
+  CreateWfsConsoleLogger(console);
+  SetWfsLogger(console);
+}
+BENCHMARK(BM_LogAsyncRingBuffer)->Threads(1)->Threads(4);
+
+// Previous behavior: unconditional colored print per operation
+static void BM_UnconditionalColoredPrint(benchmark::State &state)
+{
+  FILE *nullDevice = OpenNullDevice();
+  for (auto _ : state)
+  {
+    fmt::print(nullDevice, fg(fmt::color::green), "File download successful: {} ({} bytes)\n",
+               kPath, kBytes);
+  }
+  fclose(nullDevice);
+}
+BENCHMARK(BM_UnconditionalColoredPrint);
+
+// Statement below the compile-time minimum level: compiled out entirely
+#undef WFS_CLIENT_LOG_MIN_LEVEL
+#define WFS_CLIENT_LOG_MIN_LEVEL 3
+static void BM_LogCompiledOut(benchmark::State &state)
+{
+  SetWfsLogLevel(WfsLogLevel::Trace);
+  for (auto _ : state)
+  {
+    WFS_LOG_DEBUG("File download successful: {} ({} bytes)", kPath, kBytes);
+  }
+  SetWfsLogLevel(WfsLogLevel::Warn);
+}
+BENCHMARK(BM_LogCompiledOut);
+
+BENCHMARK_MAIN();
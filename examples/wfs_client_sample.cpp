@@ -221,6 +221,9 @@ int main(int argc, char *argv[])
   fmt::print("Server: {}:{}\n", serverIp, serverPort);
   fmt::print("Username: {}\n", username);
 
+  // Show connection progress and per-operation results from the library
+  SetWfsLogLevel(WfsLogLevel::Info);
+
   // Create client
   WfsConnectionParams connParams;
   connParams.serverIp = serverIp;
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace wfs_client
+{
+
+  // Cooperative cancellation shared by the caller and the calls it is passed
+  // to. Cancel() makes those calls give up at their next check: socket waits
+  // are polled, retries stop and queued write-behind uploads are dropped.
+  // Thread-safe; once cancelled it stays cancelled.
+  class WfsCancellationToken
+  {
+  public:
+    void Cancel()
+    {
+      m_cancelled.store(true, std::memory_order_release);
+    }
+
+    bool IsCancelled() const
+    {
+      return m_cancelled.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::atomic<bool> m_cancelled{false};
+  };
+
+  // Per-call limits, on top of the connection's send/receive timeouts
+  struct WfsCallOptions
+  {
+    // milliseconds for the whole call: waiting for the client, every attempt
+    // and the backoff between them (0 = no deadline)
+    int timeout{0};
+    std::shared_ptr<const WfsCancellationToken> cancel;
+
+    WfsCallOptions() = default;
+    explicit WfsCallOptions(int timeoutMs, std::shared_ptr<const WfsCancellationToken> token = nullptr)
+        : timeout(timeoutMs), cancel(std::move(token))
+    {
+    }
+  };
+
+} // namespace wfs_client
@@ -8,14 +8,30 @@
 namespace wfs_client
 {
 
+  class IWfsFaultInjector;
+
+  // Where an error came from, for callers that react to the cause rather
+  // than the message
+  enum class WfsErrorCategory
+  {
+    None,             // no error, or one without a more specific cause
+    Server,           // reported by the server for this request
+    Unavailable,      // server not connected or marked down by the breaker
+    Transport,        // the exchange failed on the connection
+    Cancelled,        // the caller's cancellation token fired
+    DeadlineExceeded  // the caller's deadline passed
+  };
+
   // Error information structure
   struct WfsErrorInfo
   {
     int32_t code{0};
     std::string info;
+    WfsErrorCategory category{WfsErrorCategory::None};
 
     WfsErrorInfo() = default;
-    WfsErrorInfo(int32_t c, const std::string &i) : code(c), info(i) {}
+    WfsErrorInfo(int32_t c, const std::string &i, WfsErrorCategory cat = WfsErrorCategory::None)
+        : code(c), info(i), category(cat) {}
 
     bool isSet() const { return code != 0 || !info.empty(); }
   };
@@ -32,9 +48,10 @@ namespace wfs_client
 
     // Helper methods for returning operation results
     static WfsResult Success() { return WfsResult(true); }
-    static WfsResult Failure(int32_t code, const std::string &message)
+    static WfsResult Failure(int32_t code, const std::string &message,
+                             WfsErrorCategory category = WfsErrorCategory::None)
     {
-      return WfsResult(false, WfsErrorInfo(code, message));
+      return WfsResult(false, WfsErrorInfo(code, message, category));
     }
 
     // Implicit conversion to boolean for direct use in conditions
@@ -74,6 +91,78 @@ namespace wfs_client
     WfsErrorInfo error;
   };
 
+  // Durability policy of the offline upload journal
+  enum class WfsJournalSync
+  {
+    None,     // Leave writing back to the OS
+    Interval, // fsync once per journalSyncInterval while records are unsynced
+    Always    // fsync after every record
+  };
+
+  // Waits between attempts of a failed RPC: exponential backoff with full
+  // jitter. Transport failures of Get/List/Ping/Auth are retried; uploads,
+  // deletes and renames only when the request never fully reached the server
+  // (or, for uploads, always with retryAppend).
+  struct WfsRetryPolicy
+  {
+    int initialBackoff{10};  // milliseconds, ceiling of the first wait
+    int maxBackoff{1000};    // milliseconds, ceiling of any wait
+    double multiplier{2.0};
+    int maxElapsed{10000};   // milliseconds since the first attempt, no retry after that (0 = unlimited)
+    bool retryAppend{false}; // retry uploads even after they were sent (server overwrites by name)
+  };
+
+  // Adaptive reply timeouts: each wait for a reply is bounded by what the
+  // connection's own replies predict (smoothed RTT plus request size over
+  // observed throughput, with percentile slack) instead of the static
+  // receiveTimeout, which stays the upper bound. A timeout doubles the next
+  // one until replies arrive again.
+  struct WfsAdaptiveTimeout
+  {
+    bool enabled{false};
+    int minTimeout{250};  // milliseconds, floor of any adaptive wait
+    int warmupSamples{8}; // replies observed before timeouts adapt
+  };
+
+  // Fail-fast protection against a sick server. Once the share of calls
+  // that failed in the transport among the latest window reaches
+  // failureRate, calls fail immediately for openDuration; then a single
+  // trial Ping decides whether the breaker closes or stays open for another
+  // period.
+  struct WfsCircuitBreakerPolicy
+  {
+    bool enabled{false};
+    int window{20};          // latest call outcomes considered
+    int minCalls{10};        // outcomes needed before the breaker may open
+    double failureRate{0.5}; // share of failed calls that opens the breaker
+    int openDuration{5000};  // milliseconds of failing fast before the trial Ping
+  };
+
+  // Background health checking: a connection idle for idleInterval is
+  // pinged, and one found dead (or lost meanwhile) is reopened and
+  // re-authenticated before the next call needs it. Connections dropped by
+  // NAT/firewall idle timers then cost nothing on the request path.
+  struct WfsKeepalive
+  {
+    bool enabled{false};
+    int idleInterval{30000}; // milliseconds without traffic before a Ping
+    int timeout{2000};       // milliseconds a health check (Ping or reconnect) may take
+  };
+
+  // Simulated WAN conditions imposed on every connection of a client, for
+  // reproducible performance tests over loopback. Delays are drawn from a
+  // generator seeded with seed.
+  struct WfsNetworkSimulation
+  {
+    bool enabled{false};
+    int64_t rttMicros{0};               // round trip added to connect and every request
+    int64_t jitterMicros{0};            // extra per-request delay, uniform in [0, jitterMicros]
+    int64_t bandwidthBytesPerSecond{0}; // per direction (0 = unlimited)
+    double stallProbability{0.0};       // chance that a request stalls
+    int64_t stallMicros{0};             // stall duration (beyond receiveTimeout it times out)
+    uint64_t seed{1};
+  };
+
   // Authentication information
   struct WfsAuthInfo
   {
@@ -85,15 +174,99 @@ namespace wfs_client
         : username(user), password(pwd) {}
   };
 
+  // One node of a multi-endpoint client
+  struct WfsEndpoint
+  {
+    std::string serverIp;
+    int serverPort{9090};
+    int weight{1}; // share of the requests relative to the other endpoints
+
+    WfsEndpoint() = default;
+    WfsEndpoint(const std::string &ip, int port, int endpointWeight = 1)
+        : serverIp(ip), serverPort(port), weight(endpointWeight) {}
+  };
+
+  // How a multi-endpoint client picks the endpoint of a request
+  enum class WfsLoadBalancing
+  {
+    LeastOutstanding, // fewest requests in flight per unit of weight
+    LowestLatency     // lowest EWMA latency, scaled by requests in flight per unit of weight
+  };
+
+  // Paths spread over nodes holding different data: each path belongs to
+  // the replicas nodes that follow its hash on a ring where every node
+  // appears virtualNodes * weight times. Adding or removing a node only
+  // moves the paths of the ring arcs it gains or loses.
+  struct WfsSharding
+  {
+    std::vector<WfsEndpoint> nodes;
+    int virtualNodes{128}; // ring points per unit of node weight
+    int replicas{1};       // nodes holding each path
+  };
+
+  // Hedged reads over replicas (endpoints, or sharding with replicas > 1):
+  // a download still unanswered after the delayPercentile of recent
+  // download latencies is sent to a second replica as well, the first
+  // reply wins and the other request is cancelled. Hedges are limited to
+  // budget times the number of downloads.
+  struct WfsHedging
+  {
+    bool enabled{false};
+    double delayPercentile{0.95};
+    int minDelay{5};      // milliseconds, floor of the hedge delay
+    double budget{0.05};  // hedges per download, on average
+  };
+
   // Connection parameters
   struct WfsConnectionParams
   {
     std::string serverIp;
     int serverPort{9090};
+
+    // Several nodes serving the same data, used instead of serverIp/serverPort
+    // when not empty: one connection each, every request routed by loadBalancing
+    std::vector<WfsEndpoint> endpoints;
+    WfsLoadBalancing loadBalancing{WfsLoadBalancing::LeastOutstanding};
+    int endpointCooldown{1000}; // milliseconds an endpoint is avoided after a failed call
+
+    // Nodes holding different parts of the data, used instead of the above
+    // when sharding.nodes is not empty
+    WfsSharding sharding;
+    WfsHedging hedging;
+
     int connectTimeout{10000}; // milliseconds
     int receiveTimeout{30000}; // milliseconds
     int sendTimeout{30000};    // milliseconds
-    int maxRetries{3};
+    int maxRetries{3}; // attempts per operation, see retryPolicy
+    WfsRetryPolicy retryPolicy;
+    WfsAdaptiveTimeout adaptiveTimeout;
+    WfsCircuitBreakerPolicy circuitBreaker;
+    WfsKeepalive keepalive;
+    int maxMessageSize{100 * 1024 * 1024}; // bytes, largest upload/download/listing message accepted
+    int listingCacheTtl{5000}; // milliseconds, directory listings reused by Stat/Exists (0 disables)
+    int slowRequestThreshold{0}; // milliseconds, uploads/downloads/listings slower than this are logged (0 disables)
+
+    // Write-behind mode: UploadFile returns once queued, Flush() waits for durability
+    bool writeBehind{false};
+    int writeBehindFlushInterval{20};                          // milliseconds
+    int writeBehindMaxBatch{32};                               // uploads per pipelined batch
+    int64_t writeBehindMaxQueuedBytes{64 * 1024 * 1024};       // UploadFile blocks above this (0 = unbounded)
+
+    // Offline upload journal: uploads made while the server is unreachable are
+    // stored under journalDir and replayed once it is back (empty disables)
+    std::string journalDir;
+    int64_t journalSegmentBytes{64 * 1024 * 1024};
+    WfsJournalSync journalSync{WfsJournalSync::Interval};
+    int journalSyncInterval{1000};  // milliseconds
+    int journalDrainConnections{4}; // parallel replay connections
+    int journalPipelineDepth{16};   // Appends in flight per replay connection
+    int journalRetryInterval{5000}; // milliseconds between replay attempts
+
+    // Testing only: delay traffic as configured (disabled by default)
+    WfsNetworkSimulation networkSimulation;
+
+    // Testing only: fail connections on demand (see CreateWfsFaultInjector)
+    std::shared_ptr<IWfsFaultInjector> faultInjector;
 
     WfsConnectionParams() = default;
     WfsConnectionParams(const std::string &ip, int port)
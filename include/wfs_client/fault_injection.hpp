@@ -0,0 +1,43 @@
+#pragma once
+
+#include "wfs_client/wfs_exports.hpp"
+#include <cstdint>
+#include <memory>
+
+namespace wfs_client
+{
+
+  enum class WfsFaultType
+  {
+    None,
+    DropConnection, // connection reset once afterBytes more bytes were exchanged
+    Timeout,        // next reply never arrives: TIMED_OUT after the receive timeout
+    CorruptFrame,   // reply bytes are garbled once afterBytes more bytes were exchanged
+    RefuseConnect   // the next count connection attempts are refused
+  };
+
+  struct WfsFaultStats
+  {
+    uint64_t injected{0};    // faults fired so far
+    uint64_t wastedBytes{0}; // bytes of the requests/replies cut short by a fault
+    uint64_t bytesSent{0};
+    uint64_t bytesReceived{0};
+  };
+
+  // Testing aid: breaks the connections of clients whose
+  // WfsConnectionParams::faultInjector points at it, on demand. One injector
+  // may be shared by several clients and survives their reconnects.
+  class IWfsFaultInjector
+  {
+  public:
+    virtual ~IWfsFaultInjector() = default;
+
+    // Replace any armed fault; count applies to RefuseConnect
+    virtual void Arm(WfsFaultType type, int64_t afterBytes = 0, int count = 1) = 0;
+    virtual void Disarm() = 0;
+    virtual WfsFaultStats Stats() const = 0;
+  };
+
+  WFS_CLIENT_API void CreateWfsFaultInjector(std::shared_ptr<IWfsFaultInjector> &injector);
+
+} // namespace wfs_client
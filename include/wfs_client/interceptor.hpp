@@ -0,0 +1,69 @@
+#pragma once
+
+#include "wfs_client/iwfs_client.hpp"
+#include "wfs_client/wfs_exports.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace wfs_client
+{
+
+  // Operation passed down the interceptor chain. The pointers reference the
+  // caller's arguments and are only valid during the call.
+  struct WfsRequest
+  {
+    WfsOpType op{WfsOpType::Count};      // Append, Get, Delete, Rename, List or Ping
+    const std::string *path{nullptr};    // remote path (old path for Rename, null for Ping)
+    const std::string *newPath{nullptr}; // Rename only
+    const WfsFileData *file{nullptr};    // Append only
+    const WfsCallOptions *options{nullptr}; // deadline/cancellation of the call
+  };
+
+  // Outcome passed back up the chain. Payloads are shared immutable buffers,
+  // so keeping or replacing them does not copy file data.
+  struct WfsResponse
+  {
+    WfsResult result;
+    std::shared_ptr<const std::string> data;   // Get
+    std::shared_ptr<const WfsDirList> dirList; // List
+    int8_t pingResult{0};                      // Ping
+  };
+
+  // Cross-cutting hook around UploadFile, DownloadFile(Shared), DeleteFile,
+  // RenameFile, ListDirectory and Ping. Interceptors run in registration
+  // order on the way in and in reverse order on the way out, and may be
+  // called concurrently from several threads.
+  class IWfsInterceptor
+  {
+  public:
+    virtual ~IWfsInterceptor() = default;
+
+    // Return true to short-circuit: response is then the operation's
+    // outcome and neither later interceptors nor the server are called
+    virtual bool OnRequest(const WfsRequest &request, WfsResponse &response)
+    {
+      (void)request;
+      (void)response;
+      return false;
+    }
+
+    // Called with the outcome (which may be modified) unless this
+    // interceptor short-circuited the request itself
+    virtual void OnResponse(const WfsRequest &request, WfsResponse &response)
+    {
+      (void)request;
+      (void)response;
+    }
+  };
+
+  // As CreateWfsClient, running every operation through interceptors. The
+  // chain is fixed for the lifetime of the client.
+  WFS_CLIENT_API bool CreateWfsClientWithInterceptors(
+      std::shared_ptr<IWfsClient> &client,
+      const WfsConnectionParams &params,
+      const WfsAuthInfo &authInfo,
+      const std::vector<std::shared_ptr<IWfsInterceptor>> &interceptors);
+
+} // namespace wfs_client
@@ -1,9 +1,13 @@
 #pragma once
 
+#include "wfs_client/call_options.hpp"
 #include "wfs_client/datatype_.hpp"
+#include "wfs_client/logger.hpp"
+#include "wfs_client/metrics.hpp"
 #include "wfs_client/wfs_exports.hpp"
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace wfs_client
 {
@@ -26,23 +30,50 @@ namespace wfs_client
     // Authenticate
     virtual WfsResult Authenticate(const WfsAuthInfo &authInfo) = 0;
 
-    // Upload file
-    virtual WfsResult UploadFile(const WfsFileData &fileData) = 0;
+    // File operations take optional per-call limits (deadline, cancellation
+    // token). A call that hits one fails with "Call deadline exceeded" or
+    // "Call cancelled"; a connection it aborted mid-exchange is reopened by
+    // the next call.
+
+    // Upload file (with write-behind, the deadline only bounds the wait for
+    // queue room; the token can still drop it while it is queued)
+    virtual WfsResult UploadFile(const WfsFileData &fileData,
+                                 const WfsCallOptions &options = WfsCallOptions()) = 0;
 
     // Download file
-    virtual WfsResult DownloadFile(const std::string &remotePath, std::string &outData) = 0;
+    virtual WfsResult DownloadFile(const std::string &remotePath, std::string &outData,
+                                   const WfsCallOptions &options = WfsCallOptions()) = 0;
+
+    // Download file without copying: concurrent downloads of the same path
+    // share one request and receive the same immutable buffer
+    virtual WfsResult DownloadFileShared(const std::string &remotePath,
+                                         std::shared_ptr<const std::string> &outData,
+                                         const WfsCallOptions &options = WfsCallOptions()) = 0;
 
     // Delete file
-    virtual WfsResult DeleteFile(const std::string &remotePath) = 0;
+    virtual WfsResult DeleteFile(const std::string &remotePath,
+                                 const WfsCallOptions &options = WfsCallOptions()) = 0;
 
     // Rename file
-    virtual WfsResult RenameFile(const std::string &oldPath, const std::string &newPath) = 0;
+    virtual WfsResult RenameFile(const std::string &oldPath, const std::string &newPath,
+                                 const WfsCallOptions &options = WfsCallOptions()) = 0;
 
     // List directory contents
-    virtual WfsResult ListDirectory(const std::string &remotePath, WfsDirList &outDirList) = 0;
+    virtual WfsResult ListDirectory(const std::string &remotePath, WfsDirList &outDirList,
+                                    const WfsCallOptions &options = WfsCallOptions()) = 0;
+
+    // Get size/mtime/type of a file, resolved from the cached parent listing
+    virtual WfsResult Stat(const std::string &remotePath, WfsDirItem &outItem) = 0;
+
+    // Check if a file or directory exists, resolved from the cached parent listing
+    virtual bool Exists(const std::string &remotePath) = 0;
+
+    // Wait until all queued write-behind uploads are written; returns the
+    // first failure among them (no-op when write-behind is disabled)
+    virtual WfsResult Flush() = 0;
 
     // Test connection
-    virtual int8_t Ping() = 0;
+    virtual int8_t Ping(const WfsCallOptions &options = WfsCallOptions()) = 0;
 
     // Check if connected
     virtual bool IsConnected() const = 0;
@@ -52,6 +83,18 @@ namespace wfs_client
 
     // Get last error
     virtual WfsErrorInfo GetLastError() const = 0;
+
+    // Snapshot of per-RPC latency histograms, payload byte counters and
+    // transport errors since the client was created
+    virtual WfsMetricsSnapshot GetMetrics() const = 0;
+
+    // Record RPCs of type op slower than thresholdMicros in the slow request
+    // log (0 disables; overrides WfsConnectionParams::slowRequestThreshold)
+    virtual void SetSlowRequestThreshold(WfsOpType op, int64_t thresholdMicros) = 0;
+
+    // Move up to maxRecords slow request records into outRecords (appended);
+    // returns the number moved. The log is bounded, drain it periodically.
+    virtual size_t DrainSlowRequests(std::vector<WfsSlowRequest> &outRecords, size_t maxRecords) = 0;
   };
 
   // Factory function with connection parameters and authentication
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "wfs_client/wfs_exports.hpp"
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace wfs_client
+{
+
+  // Log severity levels
+  enum class WfsLogLevel : int
+  {
+    Trace = 0,
+    Debug = 1,
+    Info = 2,
+    Warn = 3,
+    Error = 4,
+    Off = 5
+  };
+
+  // Log sink interface, implement to route client logs elsewhere.
+  // Log may be called concurrently from several threads.
+  class IWfsLogger
+  {
+  public:
+    virtual ~IWfsLogger() = default;
+
+    // Write one formatted message (without trailing newline)
+    virtual void Log(WfsLogLevel level, std::string_view message) = 0;
+
+    // Write out anything buffered
+    virtual void Flush() {}
+  };
+
+  // Install the process-wide logger (nullptr discards all messages).
+  // The default logger prints colored messages to stdout. Installed loggers
+  // are kept alive until the process exits.
+  WFS_CLIENT_API void SetWfsLogger(const std::shared_ptr<IWfsLogger> &logger);
+
+  // Set the minimum level passed to the logger (default: Warn, so successful
+  // operations are silent). Levels below WFS_CLIENT_LOG_MIN_LEVEL are removed
+  // at compile time and cannot be enabled here.
+  WFS_CLIENT_API void SetWfsLogLevel(WfsLogLevel level);
+
+  // Colored console logger (the default)
+  WFS_CLIENT_API void CreateWfsConsoleLogger(std::shared_ptr<IWfsLogger> &logger);
+
+  // Asynchronous logger: callers only move the message into a bounded
+  // lock-free ring buffer, a background thread forwards it to sink.
+  // Messages are dropped (and counted) when the ring is full.
+  WFS_CLIENT_API void CreateWfsAsyncLogger(std::shared_ptr<IWfsLogger> &logger,
+                                           const std::shared_ptr<IWfsLogger> &sink,
+                                           size_t capacity);
+
+} // namespace wfs_client
@@ -0,0 +1,266 @@
+#pragma once
+
+#include "wfs_client/wfs_exports.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace wfs_client
+{
+
+  // RPC types measured by the client
+  enum class WfsOpType : int
+  {
+    Connect = 0,
+    Auth,
+    Append,
+    Get,
+    Delete,
+    Rename,
+    List,
+    Ping,
+    Count
+  };
+
+  constexpr size_t kWfsOpTypeCount = static_cast<size_t>(WfsOpType::Count);
+
+  inline const char *WfsOpTypeName(WfsOpType op)
+  {
+    switch (op)
+    {
+    case WfsOpType::Connect:
+      return "connect";
+    case WfsOpType::Auth:
+      return "auth";
+    case WfsOpType::Append:
+      return "append";
+    case WfsOpType::Get:
+      return "get";
+    case WfsOpType::Delete:
+      return "delete";
+    case WfsOpType::Rename:
+      return "rename";
+    case WfsOpType::List:
+      return "list";
+    case WfsOpType::Ping:
+      return "ping";
+    default:
+      return "unknown";
+    }
+  }
+
+  // Phases of one request/reply round trip
+  enum class WfsRpcPhase : int
+  {
+    Serialize = 0, // encoding the request (time in send_* outside socket writes)
+    Send,          // socket writes
+    Wait,          // socket reads: server processing plus reply transfer
+    Deserialize,   // decoding the reply (time in recv_* outside socket reads)
+    Count
+  };
+
+  constexpr size_t kWfsRpcPhaseCount = static_cast<size_t>(WfsRpcPhase::Count);
+
+  inline const char *WfsRpcPhaseName(WfsRpcPhase phase)
+  {
+    switch (phase)
+    {
+    case WfsRpcPhase::Serialize:
+      return "serialize";
+    case WfsRpcPhase::Send:
+      return "send";
+    case WfsRpcPhase::Wait:
+      return "wait";
+    case WfsRpcPhase::Deserialize:
+      return "deserialize";
+    default:
+      return "unknown";
+    }
+  }
+
+  // Circuit breaker states (WfsConnectionParams::circuitBreaker)
+  enum class WfsBreakerState : int
+  {
+    Closed = 0, // calls go through
+    Open,       // calls fail fast
+    HalfOpen,   // a trial Ping decides, other calls fail fast
+    Count
+  };
+
+  constexpr size_t kWfsBreakerStateCount = static_cast<size_t>(WfsBreakerState::Count);
+
+  inline const char *WfsBreakerStateName(WfsBreakerState state)
+  {
+    switch (state)
+    {
+    case WfsBreakerState::Closed:
+      return "closed";
+    case WfsBreakerState::Open:
+      return "open";
+    case WfsBreakerState::HalfOpen:
+      return "half_open";
+    default:
+      return "unknown";
+    }
+  }
+
+  // HDR-style latency histogram in microseconds: every power-of-two range is
+  // split into 16 linear sub-buckets, giving ~6% relative precision from
+  // 1 us up to ~19 hours with a fixed number of buckets
+  struct WfsLatencyHistogram
+  {
+    static constexpr int kSubBucketBits = 4;
+    static constexpr uint64_t kSubBuckets = 1ull << kSubBucketBits;
+    static constexpr int kMaxBits = 36;
+    static constexpr size_t kBucketCount = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+    std::array<uint64_t, kBucketCount> counts{};
+    uint64_t count{0};
+    uint64_t sumMicros{0};
+    uint64_t maxMicros{0};
+
+    static size_t BucketIndex(uint64_t micros)
+    {
+      if (micros < kSubBuckets)
+      {
+        return static_cast<size_t>(micros);
+      }
+      int msb = 63;
+      while (!(micros >> msb))
+      {
+        --msb;
+      }
+      if (msb >= kMaxBits)
+      {
+        return kBucketCount - 1;
+      }
+      const int shift = msb - kSubBucketBits;
+      return static_cast<size_t>((shift + 1) * kSubBuckets + ((micros >> shift) & (kSubBuckets - 1)));
+    }
+
+    // Largest value that falls into a bucket
+    static uint64_t BucketUpperBound(size_t index)
+    {
+      if (index < kSubBuckets)
+      {
+        return index;
+      }
+      const uint64_t shift = index / kSubBuckets - 1;
+      const uint64_t sub = index % kSubBuckets;
+      return ((kSubBuckets + sub + 1) << shift) - 1;
+    }
+
+    // Value at quantile q (0..1), accurate to the bucket width
+    uint64_t Percentile(double q) const
+    {
+      if (count == 0)
+      {
+        return 0;
+      }
+      const uint64_t rank = q <= 0 ? 1 : static_cast<uint64_t>(q * static_cast<double>(count) + 0.999999);
+      uint64_t seen = 0;
+      for (size_t i = 0; i < kBucketCount; ++i)
+      {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+          const uint64_t bound = BucketUpperBound(i);
+          return bound < maxMicros ? bound : maxMicros;
+        }
+      }
+      return maxMicros;
+    }
+
+    double MeanMicros() const
+    {
+      return count == 0 ? 0.0 : static_cast<double>(sumMicros) / static_cast<double>(count);
+    }
+
+    void Merge(const WfsLatencyHistogram &other)
+    {
+      for (size_t i = 0; i < kBucketCount; ++i)
+      {
+        counts[i] += other.counts[i];
+      }
+      count += other.count;
+      sumMicros += other.sumMicros;
+      maxMicros = maxMicros > other.maxMicros ? maxMicros : other.maxMicros;
+    }
+  };
+
+  // Counters of one RPC type
+  struct WfsOpMetrics
+  {
+    uint64_t calls{0};
+    uint64_t errors{0};
+    WfsLatencyHistogram latency;
+
+    // Phase breakdown of the calls that completed a round trip
+    uint64_t phaseSamples{0};
+    std::array<uint64_t, kWfsRpcPhaseCount> phaseSumNanos{};
+    std::array<uint64_t, kWfsRpcPhaseCount> phaseMaxNanos{};
+
+    double PhaseMeanMicros(WfsRpcPhase phase) const
+    {
+      return phaseSamples == 0 ? 0.0
+                               : static_cast<double>(phaseSumNanos[static_cast<size_t>(phase)]) /
+                                     static_cast<double>(phaseSamples) / 1000.0;
+    }
+  };
+
+  // Point-in-time copy of the client counters
+  struct WfsMetricsSnapshot
+  {
+    // Indexed by TTransportException::TTransportExceptionType (UNKNOWN .. CLIENT_DISCONNECT)
+    static constexpr size_t kTransportErrorTypes = 9;
+
+    std::array<WfsOpMetrics, kWfsOpTypeCount> ops{};
+    uint64_t bytesSent{0};     // file payload bytes uploaded
+    uint64_t bytesReceived{0}; // file payload bytes downloaded
+    std::array<uint64_t, kTransportErrorTypes> transportErrors{};
+
+    int64_t inFlight{0};           // RPCs waiting for their reply
+    int64_t openConnections{0};    // server connections currently open
+    uint64_t reconnects{0};        // successful connects after the first one
+    uint64_t listingCacheHits{0};  // Stat/Exists answered from a cached listing
+    uint64_t listingCacheMisses{0};
+    uint64_t coalescedReads{0};    // Get/List calls that joined an identical request in flight
+    uint64_t slowRequestsDropped{0}; // slow request records lost because the ring was full
+
+    WfsBreakerState breakerState{WfsBreakerState::Closed};
+    std::array<uint64_t, kWfsBreakerStateCount> breakerTransitions{}; // transitions into each state
+    uint64_t breakerRejected{0}; // calls failed fast by the open breaker
+
+    uint64_t healthPings{0};         // keepalive Pings sent on idle connections
+    uint64_t healthReconnects{0};    // dead connections reopened by the health checker
+    int64_t connectionRttMicros{0};  // smoothed Ping round trip of the connection (0 = not measured)
+
+    uint64_t hedgedReads{0}; // downloads also sent to a second replica
+    uint64_t hedgeWins{0};   // hedged downloads answered by the second replica first
+
+    const WfsOpMetrics &Op(WfsOpType op) const
+    {
+      return ops[static_cast<size_t>(op)];
+    }
+  };
+
+  // Record of an RPC that exceeded its slow request threshold
+  struct WfsSlowRequest
+  {
+    WfsOpType op{WfsOpType::Count};
+    std::string path;
+    uint64_t bytes{0};            // payload bytes sent or received
+    int64_t timestampMicros{0};   // completion time, microseconds since the Unix epoch
+    uint64_t durationMicros{0};
+    std::array<uint64_t, kWfsRpcPhaseCount> phaseMicros{}; // zero when the call failed before a reply
+    uint64_t connectionId{0};     // increments with every (re)connect of the client
+    int retries{0};
+    bool ok{false};
+  };
+
+  // Human-readable table of a snapshot (latency percentiles and mean phase
+  // breakdown per RPC type), for debug output
+  WFS_CLIENT_API void DumpWfsMetrics(const WfsMetricsSnapshot &metrics, std::string &outText);
+
+} // namespace wfs_client
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "wfs_client/iwfs_client.hpp"
+#include "wfs_client/metrics.hpp"
+#include "wfs_client/wfs_exports.hpp"
+#include <memory>
+#include <string>
+
+namespace wfs_client
+{
+
+  // Prometheus exporter settings; enable the file output, the HTTP endpoint
+  // or both
+  struct WfsPrometheusExporterOptions
+  {
+    // Metrics file rewritten atomically every fileInterval, e.g. for the
+    // node_exporter textfile collector (empty disables)
+    std::string filePath;
+    int fileInterval{10000}; // milliseconds
+
+    // Embedded HTTP endpoint serving GET /metrics (port 0 disables)
+    std::string listenAddress{"127.0.0.1"};
+    int listenPort{0};
+
+    std::string clientLabel; // value of a client="..." label on every series (empty omits it)
+  };
+
+  // Running exporter; stops when released
+  class IWfsPrometheusExporter
+  {
+  public:
+    virtual ~IWfsPrometheusExporter() = default;
+
+    // Stop the file writer and HTTP endpoint
+    virtual void Stop() = 0;
+  };
+
+  // Render a metrics snapshot in Prometheus text exposition format
+  WFS_CLIENT_API void RenderWfsPrometheusMetrics(const WfsMetricsSnapshot &metrics,
+                                                 const std::string &clientLabel,
+                                                 std::string &outText);
+
+  // Start exporting the metrics of client. The exporter only keeps a weak
+  // reference, so it never extends the client's lifetime.
+  WFS_CLIENT_API bool CreateWfsPrometheusExporter(std::shared_ptr<IWfsPrometheusExporter> &exporter,
+                                                  const std::shared_ptr<IWfsClient> &client,
+                                                  const WfsPrometheusExporterOptions &options);
+
+} // namespace wfs_client
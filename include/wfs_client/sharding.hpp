@@ -0,0 +1,47 @@
+#pragma once
+
+#include "wfs_client/interceptor.hpp"
+#include "wfs_client/iwfs_client.hpp"
+#include "wfs_client/wfs_exports.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace wfs_client
+{
+
+  // Client over the nodes of WfsConnectionParams::sharding. Uploads go to
+  // every replica of the path, reads to the first replica that answers,
+  // listings to all nodes (merged by name). Deletes succeed if any replica
+  // deleted its copy; copies on replicas that were down stay behind.
+  //
+  // The ring may change while in use. Paths whose owners changed stay where
+  // they are until moved by the application; until FinishRingChange(),
+  // reads and deletes also try their owners on the ring before the first
+  // change, so moved paths stay readable meanwhile.
+  class IWfsShardedClient : public IWfsClient
+  {
+  public:
+    // Connect to (and authenticate with) a new node and put it on the ring
+    virtual WfsResult AddShard(const WfsEndpoint &node) = 0;
+
+    // Take a node off the ring (it still serves reads until FinishRingChange)
+    virtual WfsResult RemoveShard(const std::string &serverIp, int serverPort) = 0;
+
+    // Paths have been moved to their new owners: forget the old ring
+    virtual void FinishRingChange() = 0;
+
+    // Nodes that own remotePath on the current ring, primary first
+    virtual std::vector<WfsEndpoint> ShardsOf(const std::string &remotePath) const = 0;
+  };
+
+  // Connect to every node of params.sharding.nodes and authenticate;
+  // succeeds if any node can be reached. interceptors wrap the operations
+  // of every node.
+  WFS_CLIENT_API bool CreateWfsShardedClient(
+      std::shared_ptr<IWfsShardedClient> &client,
+      const WfsConnectionParams &params,
+      const WfsAuthInfo &authInfo,
+      const std::vector<std::shared_ptr<IWfsInterceptor>> &interceptors = {});
+
+} // namespace wfs_client
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "wfs_client/wfs_exports.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace wfs_client
+{
+
+  // Trace context propagated from the caller (e.g. parsed from a W3C
+  // traceparent header); spans of client calls become its children
+  struct WfsTraceContext
+  {
+    uint64_t traceIdHigh{0};
+    uint64_t traceIdLow{0};
+    uint64_t parentSpanId{0};
+    bool sampled{true};
+  };
+
+  // One finished span. Operation spans are named after the RPC
+  // ("wfs.download"); their phase sub-spans are "serialize", "send", "wait"
+  // and "deserialize".
+  struct WfsSpan
+  {
+    uint64_t traceIdHigh{0};
+    uint64_t traceIdLow{0};
+    uint64_t spanId{0};
+    uint64_t parentSpanId{0}; // 0 for a root span
+    std::string name;
+    std::string path;         // remote path of the operation, if any
+    int64_t startMicros{0};   // microseconds since the Unix epoch
+    int64_t durationMicros{0};
+    uint64_t threadId{0};
+    uint64_t bytes{0};        // payload bytes sent or received
+    bool ok{true};
+  };
+
+  // Span exporter interface. Export may be called concurrently from
+  // several threads.
+  class IWfsTraceSink
+  {
+  public:
+    virtual ~IWfsTraceSink() = default;
+
+    virtual void Export(const WfsSpan &span) = 0;
+
+    // Write out anything buffered
+    virtual void Flush() {}
+  };
+
+  // Sink keeping finished spans in memory, mainly for tests
+  class IWfsMemoryTraceSink : public IWfsTraceSink
+  {
+  public:
+    virtual std::vector<WfsSpan> Spans() const = 0;
+    virtual void Clear() = 0;
+  };
+
+  // Install the process-wide trace sink (nullptr disables tracing, the
+  // default). Traces started by the client itself are kept with probability
+  // sampleRate (0..1); calls made under a caller context follow its sampled
+  // flag. Installed sinks are kept alive until the process exits.
+  WFS_CLIENT_API void SetWfsTraceSink(const std::shared_ptr<IWfsTraceSink> &sink, double sampleRate);
+
+  // Attach the caller's trace context to client calls made by this thread
+  WFS_CLIENT_API void SetWfsTraceContext(const WfsTraceContext &context);
+
+  // Detach the trace context of this thread
+  WFS_CLIENT_API void ClearWfsTraceContext();
+
+  // In-memory sink keeping at most maxSpans spans (oldest dropped first)
+  WFS_CLIENT_API void CreateWfsMemoryTraceSink(std::shared_ptr<IWfsMemoryTraceSink> &sink, size_t maxSpans);
+
+  // Sink writing Chrome trace event JSON (chrome://tracing, Perfetto)
+  WFS_CLIENT_API bool CreateWfsChromeTraceSink(std::shared_ptr<IWfsTraceSink> &sink, const std::string &filePath);
+
+  // Scoped trace context for the calling thread
+  class WfsTraceContextScope
+  {
+  public:
+    explicit WfsTraceContextScope(const WfsTraceContext &context)
+    {
+      SetWfsTraceContext(context);
+    }
+
+    ~WfsTraceContextScope()
+    {
+      ClearWfsTraceContext();
+    }
+
+    WfsTraceContextScope(const WfsTraceContextScope &) = delete;
+    WfsTraceContextScope &operator=(const WfsTraceContextScope &) = delete;
+  };
+
+} // namespace wfs_client
@@ -0,0 +1,114 @@
+// Standalone in-memory WFS server for load tests and local development
+
+#include <fmt/core.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <thread>
+
+#include "wfs_mock_server.hpp"
+
+using namespace wfs_client;
+
+namespace
+{
+
+  std::atomic<bool> g_stop{false};
+
+  void OnSignal(int)
+  {
+    g_stop = true;
+  }
+
+  void ShowHelp(const char *programName)
+  {
+    fmt::print("Usage: {} [options]\n\n", programName);
+    fmt::print("Options:\n");
+    fmt::print("  --address <ip>           Listen address (default 127.0.0.1)\n");
+    fmt::print("  --port <port>            Listen port (default 9090, 0 picks a free port)\n");
+    fmt::print("  --user <name>            Required username (default: accept any credentials)\n");
+    fmt::print("  --password <password>    Required password\n");
+    fmt::print("  --latency-us <micros>    Delay added to every request\n");
+    fmt::print("  --bandwidth <bytes/s>    Simulated payload transfer rate (0 = unlimited)\n");
+    fmt::print("  --max-message <bytes>    Largest request/reply accepted (default 100 MB)\n");
+    fmt::print("  --shards <count>         Object store shards (default 64)\n");
+  }
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  WfsMockServerOptions options;
+  options.port = 9090;
+
+  try
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      const std::string arg = argv[i];
+      if (arg == "--help" || arg == "-h")
+      {
+        ShowHelp(argv[0]);
+        return 0;
+      }
+      if (i + 1 >= argc)
+      {
+        fmt::print(stderr, "Missing value for {}\n", arg);
+        ShowHelp(argv[0]);
+        return 1;
+      }
+      const std::string value = argv[++i];
+      if (arg == "--address")
+        options.address = value;
+      else if (arg == "--port")
+        options.port = std::stoi(value);
+      else if (arg == "--user")
+        options.username = value;
+      else if (arg == "--password")
+        options.password = value;
+      else if (arg == "--latency-us")
+        options.latencyMicros = std::stoll(value);
+      else if (arg == "--bandwidth")
+        options.bandwidthBytesPerSecond = std::stoll(value);
+      else if (arg == "--max-message")
+        options.maxMessageSize = std::stoi(value);
+      else if (arg == "--shards")
+        options.shards = static_cast<size_t>(std::stoul(value));
+      else
+      {
+        fmt::print(stderr, "Unknown option {}\n", arg);
+        ShowHelp(argv[0]);
+        return 1;
+      }
+    }
+  }
+  catch (const std::exception &e)
+  {
+    fmt::print(stderr, "Invalid option value: {}\n", e.what());
+    return 1;
+  }
+
+  std::signal(SIGINT, OnSignal);
+  std::signal(SIGTERM, OnSignal);
+
+  try
+  {
+    WfsMockServer server(options);
+    fmt::print("WFS mock server listening on {}:{}\n", options.address, server.Port());
+    while (!g_stop)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    fmt::print("Stopping, {} files stored\n", server.FileCount());
+  }
+  catch (const std::exception &e)
+  {
+    fmt::print(stderr, "{}\n", e.what());
+    return 1;
+  }
+  return 0;
+}
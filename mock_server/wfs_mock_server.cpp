@@ -0,0 +1,484 @@
+#include "wfs_mock_server.hpp"
+
+#include <thrift/TConfiguration.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/server/TThreadedServer.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TServerSocket.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "WfsIface.h"
+#include "wfs_client/utils.hpp"
+
+using namespace apache::thrift;
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::server;
+using namespace apache::thrift::transport;
+
+namespace wfs_client
+{
+
+  // Files hashed by path over independently locked shards. Each shard also
+  // indexes its files by parent directory, so List visits one bucket per
+  // shard instead of every file.
+  class WfsMockObjectStore
+  {
+  public:
+    struct File
+    {
+      std::shared_ptr<const std::string> data;
+      int64_t mtime{0};
+    };
+
+    explicit WfsMockObjectStore(size_t shards)
+    {
+      size_t count = 1;
+      while (count < shards)
+      {
+        count <<= 1;
+      }
+      m_mask = count - 1;
+      m_shards = std::make_unique<Shard[]>(count);
+    }
+
+    void Put(const std::string &path, std::shared_ptr<const std::string> data)
+    {
+      Shard &shard = ShardOf(path);
+      std::unique_lock<std::shared_mutex> lock(shard.mutex);
+      Insert(shard, path, File{std::move(data), Now()});
+    }
+
+    std::shared_ptr<const std::string> Get(const std::string &path) const
+    {
+      const Shard &shard = ShardOf(path);
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      auto it = shard.files.find(path);
+      return it != shard.files.end() ? it->second.data : nullptr;
+    }
+
+    bool Erase(const std::string &path)
+    {
+      Shard &shard = ShardOf(path);
+      std::unique_lock<std::shared_mutex> lock(shard.mutex);
+      return Remove(shard, path, nullptr);
+    }
+
+    bool Rename(const std::string &path, const std::string &newPath)
+    {
+      Shard &from = ShardOf(path);
+      Shard &to = ShardOf(newPath);
+      if (&from == &to)
+      {
+        std::unique_lock<std::shared_mutex> lock(from.mutex);
+        return Move(from, to, path, newPath);
+      }
+      // Fixed lock order between the two shards
+      Shard &first = &from < &to ? from : to;
+      Shard &second = &from < &to ? to : from;
+      std::unique_lock<std::shared_mutex> firstLock(first.mutex);
+      std::unique_lock<std::shared_mutex> secondLock(second.mutex);
+      return Move(from, to, path, newPath);
+    }
+
+    void List(const std::string &dir, std::vector<DirItem> &out) const
+    {
+      for (size_t i = 0; i <= m_mask; ++i)
+      {
+        const Shard &shard = m_shards[i];
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto names = shard.dirs.find(dir);
+        if (names == shard.dirs.end())
+        {
+          continue;
+        }
+        for (const auto &name : names->second)
+        {
+          const File &file = shard.files.at(name);
+          DirItem item;
+          item.__set_name(name);
+          item.__set_size(static_cast<int64_t>(file.data->size()));
+          item.__set_mtime(file.mtime);
+          item.__set_isDir(false);
+          out.push_back(std::move(item));
+        }
+      }
+      std::sort(out.begin(), out.end(), [](const DirItem &a, const DirItem &b)
+                { return a.name < b.name; });
+    }
+
+    size_t Size() const
+    {
+      size_t size = 0;
+      for (size_t i = 0; i <= m_mask; ++i)
+      {
+        std::shared_lock<std::shared_mutex> lock(m_shards[i].mutex);
+        size += m_shards[i].files.size();
+      }
+      return size;
+    }
+
+  private:
+    struct alignas(64) Shard
+    {
+      mutable std::shared_mutex mutex;
+      std::unordered_map<std::string, File> files;
+      std::unordered_map<std::string, std::set<std::string>> dirs;
+    };
+
+    static int64_t Now()
+    {
+      return std::chrono::duration_cast<std::chrono::seconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+          .count();
+    }
+
+    Shard &ShardOf(const std::string &path)
+    {
+      return m_shards[std::hash<std::string>()(path) & m_mask];
+    }
+
+    const Shard &ShardOf(const std::string &path) const
+    {
+      return m_shards[std::hash<std::string>()(path) & m_mask];
+    }
+
+    static void Insert(Shard &shard, const std::string &path, File file)
+    {
+      auto [it, inserted] = shard.files.insert_or_assign(path, std::move(file));
+      if (inserted)
+      {
+        shard.dirs[utils::getDirectory(path)].insert(path);
+      }
+    }
+
+    static bool Remove(Shard &shard, const std::string &path, File *removed)
+    {
+      auto it = shard.files.find(path);
+      if (it == shard.files.end())
+      {
+        return false;
+      }
+      if (removed)
+      {
+        *removed = std::move(it->second);
+      }
+      shard.files.erase(it);
+
+      auto names = shard.dirs.find(utils::getDirectory(path));
+      if (names != shard.dirs.end())
+      {
+        names->second.erase(path);
+        if (names->second.empty())
+        {
+          shard.dirs.erase(names);
+        }
+      }
+      return true;
+    }
+
+    static bool Move(Shard &from, Shard &to, const std::string &path, const std::string &newPath)
+    {
+      File file;
+      if (!Remove(from, path, &file))
+      {
+        return false;
+      }
+      Insert(to, newPath, std::move(file));
+      return true;
+    }
+
+    std::unique_ptr<Shard[]> m_shards;
+    size_t m_mask{0};
+  };
+
+  namespace
+  {
+
+    const int32_t kErrorNotFound = 1;
+    const int32_t kErrorNotAuthenticated = 2;
+
+    WfsAck Ack(bool ok, int32_t code = 0, const std::string &info = std::string())
+    {
+      WfsAck ack;
+      ack.__set_ok(ok);
+      if (!ok)
+      {
+        WfsError error;
+        error.__set_code(code);
+        error.__set_info(info);
+        ack.__set_error(error);
+      }
+      return ack;
+    }
+
+    // One handler per connection, holding that connection's auth state.
+    // Grown from gen-cpp/WfsIface_server.skeleton.cpp.
+    class MockHandler : public WfsIfaceIf
+    {
+    public:
+      MockHandler(std::shared_ptr<WfsMockObjectStore> store,
+                  std::shared_ptr<const WfsMockServerOptions> options)
+          : m_store(std::move(store)), m_options(std::move(options))
+      {
+      }
+
+      void Append(WfsAck &_return, const WfsFile &file) override
+      {
+        Simulate(file.data.size());
+        if (!Authorized(_return))
+        {
+          return;
+        }
+        m_store->Put(file.name, std::make_shared<const std::string>(file.data));
+        _return = Ack(true);
+      }
+
+      void Delete(WfsAck &_return, const std::string &path) override
+      {
+        Simulate(0);
+        if (!Authorized(_return))
+        {
+          return;
+        }
+        _return = m_store->Erase(path) ? Ack(true) : Ack(false, kErrorNotFound, "not found: " + path);
+      }
+
+      void Rename(WfsAck &_return, const std::string &path, const std::string &newpath) override
+      {
+        Simulate(0);
+        if (!Authorized(_return))
+        {
+          return;
+        }
+        _return = m_store->Rename(path, newpath) ? Ack(true) : Ack(false, kErrorNotFound, "not found: " + path);
+      }
+
+      void Auth(WfsAck &_return, const WfsAuth &wa) override
+      {
+        Simulate(0);
+        m_authenticated = m_options->username.empty() ||
+                          (wa.name == m_options->username && wa.pwd == m_options->password);
+        _return = m_authenticated ? Ack(true) : Ack(false, kErrorNotAuthenticated, "invalid credentials");
+      }
+
+      void Get(WfsData &_return, const std::string &path) override
+      {
+        WfsAck denied;
+        if (!Authorized(denied))
+        {
+          Simulate(0);
+          return;
+        }
+        auto data = m_store->Get(path);
+        Simulate(data ? data->size() : 0);
+        if (data)
+        {
+          _return.__set_data(*data);
+        }
+      }
+
+      void List(DirList &_return, const std::string &path) override
+      {
+        Simulate(0);
+        _return.__set_path(path);
+        WfsAck denied;
+        if (!Authorized(denied))
+        {
+          _return.__set_error(denied.error);
+          return;
+        }
+        m_store->List(path, _return.items);
+        _return.__isset.items = true;
+      }
+
+      int8_t Ping() override
+      {
+        Simulate(0);
+        return 1;
+      }
+
+    private:
+      bool Authorized(WfsAck &denied) const
+      {
+        if (m_authenticated || m_options->username.empty())
+        {
+          return true;
+        }
+        denied = Ack(false, kErrorNotAuthenticated, "not authenticated");
+        return false;
+      }
+
+      // Latency plus transfer time of payloadBytes
+      void Simulate(size_t payloadBytes) const
+      {
+        int64_t micros = m_options->latencyMicros;
+        if (m_options->bandwidthBytesPerSecond > 0)
+        {
+          micros += static_cast<int64_t>(payloadBytes) * 1000000 / m_options->bandwidthBytesPerSecond;
+        }
+        if (micros > 0)
+        {
+          std::this_thread::sleep_for(std::chrono::microseconds(micros));
+        }
+      }
+
+      std::shared_ptr<WfsMockObjectStore> m_store;
+      std::shared_ptr<const WfsMockServerOptions> m_options;
+      bool m_authenticated{false};
+    };
+
+    class MockHandlerFactory : public WfsIfaceIfFactory
+    {
+    public:
+      MockHandlerFactory(std::shared_ptr<WfsMockObjectStore> store,
+                         std::shared_ptr<const WfsMockServerOptions> options)
+          : m_store(std::move(store)), m_options(std::move(options))
+      {
+      }
+
+      WfsIfaceIf *getHandler(const TConnectionInfo &) override
+      {
+        return new MockHandler(m_store, m_options);
+      }
+
+      void releaseHandler(WfsIfaceIf *handler) override
+      {
+        delete handler;
+      }
+
+    private:
+      std::shared_ptr<WfsMockObjectStore> m_store;
+      std::shared_ptr<const WfsMockServerOptions> m_options;
+    };
+
+    // Buffered transport with the configured message size limit
+    class MockTransportFactory : public TTransportFactory
+    {
+    public:
+      explicit MockTransportFactory(std::shared_ptr<TConfiguration> config)
+          : m_config(std::move(config))
+      {
+      }
+
+      std::shared_ptr<TTransport> getTransport(std::shared_ptr<TTransport> trans) override
+      {
+        return std::make_shared<TBufferedTransport>(trans, 8192, m_config);
+      }
+
+    private:
+      std::shared_ptr<TConfiguration> m_config;
+    };
+
+    // Signals once the server socket is listening, or serving failed
+    class ReadyHandler : public TServerEventHandler
+    {
+    public:
+      void preServe() override
+      {
+        Signal(true);
+      }
+
+      void Failed()
+      {
+        Signal(false);
+      }
+
+      bool Wait(std::chrono::milliseconds timeout)
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait_for(lock, timeout, [this]()
+                      { return m_done; });
+        return m_ready;
+      }
+
+    private:
+      void Signal(bool ready)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_done)
+        {
+          m_ready = ready;
+          m_done = true;
+        }
+        m_cv.notify_all();
+      }
+
+      std::mutex m_mutex;
+      std::condition_variable m_cv;
+      bool m_ready{false};
+      bool m_done{false};
+    };
+
+  } // namespace
+
+  WfsMockServer::WfsMockServer(const WfsMockServerOptions &options)
+      : m_store(std::make_shared<WfsMockObjectStore>(options.shards))
+  {
+    auto config = std::make_shared<TConfiguration>(options.maxMessageSize);
+    auto socket = std::make_shared<TServerSocket>(options.address, options.port);
+    auto ready = std::make_shared<ReadyHandler>();
+
+    // Thread per connection: the client keeps its connection open and
+    // speaks unframed buffered transport, which rules out TNonblockingServer
+    m_server = std::make_shared<TThreadedServer>(
+        std::make_shared<WfsIfaceProcessorFactory>(std::make_shared<MockHandlerFactory>(
+            m_store, std::make_shared<const WfsMockServerOptions>(options))),
+        socket,
+        std::make_shared<MockTransportFactory>(config),
+        std::make_shared<TCompactProtocolFactory>());
+    m_server->setServerEventHandler(ready);
+    m_thread = std::thread([this, ready]()
+                           {
+                             try
+                             {
+                               m_server->serve();
+                             }
+                             catch (const TException &)
+                             {
+                               ready->Failed();
+                             } });
+
+    if (!ready->Wait(std::chrono::seconds(10)))
+    {
+      Stop();
+      throw std::runtime_error("WFS mock server cannot listen on " + options.address + ":" +
+                               std::to_string(options.port));
+    }
+    m_port = socket->getPort();
+  }
+
+  WfsMockServer::~WfsMockServer()
+  {
+    Stop();
+  }
+
+  void WfsMockServer::Put(const std::string &path, std::string data)
+  {
+    m_store->Put(path, std::make_shared<const std::string>(std::move(data)));
+  }
+
+  size_t WfsMockServer::FileCount() const
+  {
+    return m_store->Size();
+  }
+
+  void WfsMockServer::Stop()
+  {
+    if (m_thread.joinable())
+    {
+      m_server->stop();
+      m_thread.join();
+    }
+  }
+
+} // namespace wfs_client
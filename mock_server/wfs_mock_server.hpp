@@ -0,0 +1,72 @@
+#pragma once
+
+// In-memory WFS stand-in for tests, benchmarks and load tests. Files live in
+// a sharded concurrent store; connections are served thread-per-connection
+// with the client's protocol stack (buffered transport, compact protocol).
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace apache::thrift::server
+{
+  class TServer;
+}
+
+namespace wfs_client
+{
+
+  struct WfsMockServerOptions
+  {
+    std::string address{"127.0.0.1"};
+    int port{0};                           // 0 picks a free port, see WfsMockServer::Port
+    int maxMessageSize{100 * 1024 * 1024}; // bytes, largest request/reply accepted
+    size_t shards{64};                     // object store shards (rounded up to a power of two)
+
+    // Credentials checked by Auth; an empty username accepts any
+    std::string username;
+    std::string password;
+
+    // Simulated network: every request is delayed by latencyMicros plus the
+    // time its payload takes at bandwidthBytesPerSecond (0 = unlimited)
+    int64_t latencyMicros{0};
+    int64_t bandwidthBytesPerSecond{0};
+  };
+
+  class WfsMockObjectStore;
+
+  class WfsMockServer
+  {
+  public:
+    // Start serving; returns once the server accepts connections. Throws
+    // std::runtime_error if it cannot listen.
+    explicit WfsMockServer(const WfsMockServerOptions &options = WfsMockServerOptions());
+    ~WfsMockServer();
+
+    WfsMockServer(const WfsMockServer &) = delete;
+    WfsMockServer &operator=(const WfsMockServer &) = delete;
+
+    // Port actually listened on
+    int Port() const
+    {
+      return m_port;
+    }
+
+    // Store a file directly, bypassing the network
+    void Put(const std::string &path, std::string data);
+
+    size_t FileCount() const;
+
+    // Stop accepting and close all connections (also done by the destructor)
+    void Stop();
+
+  private:
+    std::shared_ptr<WfsMockObjectStore> m_store;
+    std::shared_ptr<apache::thrift::server::TServer> m_server;
+    std::thread m_thread;
+    int m_port{0};
+  };
+
+} // namespace wfs_client
@@ -0,0 +1,455 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "wfs_client/iwfs_client.hpp"
+#include "call_deadline.hpp"
+#include "hedged_read.hpp"
+#include "multi_endpoint.hpp"
+#include "wfs_log.hpp"
+
+namespace wfs_client
+{
+
+  // Client over several endpoints serving the same data. Every endpoint has
+  // a full client of its own (connection, lock, retries, breaker,
+  // keepalive), so requests to different endpoints run in parallel. Each
+  // request goes to the endpoint with the lowest score:
+  //
+  //   LeastOutstanding: (outstanding + 1) / weight
+  //   LowestLatency:    ewmaLatency * (outstanding + 1) / weight
+  //
+  // with ties broken round-robin. An endpoint whose call failed in the
+  // transport is avoided for endpointCooldown (doubling with every further
+  // failure) unless every endpoint is; reads failing that way are retried
+  // once on the next best endpoint within the caller's deadline. With
+  // hedging, downloads go through a HedgedReader instead: the next best
+  // endpoint gets a duplicate of a download that is late, and the retry of
+  // one that failed.
+  class BalancedClient : public IWfsClient
+  {
+  public:
+    BalancedClient(std::vector<std::shared_ptr<IWfsClient>> clients, const std::vector<WfsEndpoint> &endpoints)
+    {
+      for (size_t i = 0; i < clients.size() && i < endpoints.size(); ++i)
+      {
+        auto endpoint = std::make_unique<Endpoint>();
+        endpoint->client = std::move(clients[i]);
+        endpoint->address = endpoints[i];
+        endpoint->weight = std::max(1, endpoints[i].weight);
+        m_endpoints.push_back(std::move(endpoint));
+      }
+    }
+
+    // Connects every endpoint; succeeds if any endpoint does (the others
+    // keep reconnecting on their own)
+    WfsResult Connect(const WfsConnectionParams &params) override
+    {
+      m_policy = params.loadBalancing;
+      m_cooldown = std::chrono::milliseconds(std::max(0, params.endpointCooldown));
+      m_retryAppend = params.retryPolicy.retryAppend;
+      if (params.hedging.enabled && !m_hedger)
+      {
+        m_hedger = std::make_unique<HedgedReader>(params.hedging);
+      }
+      return ForAll([&](IWfsClient &client, const WfsEndpoint &endpoint)
+                    { return client.Connect(EndpointParams(params, endpoint)); });
+    }
+
+    WfsResult Reconnect() override
+    {
+      return ForAll([](IWfsClient &client, const WfsEndpoint &)
+                    { return client.Reconnect(); });
+    }
+
+    void Disconnect() override
+    {
+      for (auto &endpoint : m_endpoints)
+      {
+        endpoint->client->Disconnect();
+      }
+    }
+
+    WfsResult Authenticate(const WfsAuthInfo &authInfo) override
+    {
+      return ForAll([&](IWfsClient &client, const WfsEndpoint &)
+                    { return client.Authenticate(authInfo); });
+    }
+
+    WfsResult UploadFile(const WfsFileData &fileData, const WfsCallOptions &options) override
+    {
+      return Route(options, m_retryAppend, [&](IWfsClient &client, const WfsCallOptions &callOptions)
+                   { return client.UploadFile(fileData, callOptions); });
+    }
+
+    WfsResult DownloadFile(const std::string &remotePath, std::string &outData,
+                           const WfsCallOptions &options) override
+    {
+      std::shared_ptr<const std::string> sharedData;
+      WfsResult result = DownloadFileShared(remotePath, sharedData, options);
+      if (result && sharedData)
+      {
+        outData = *sharedData;
+      }
+      return result;
+    }
+
+    WfsResult DownloadFileShared(const std::string &remotePath,
+                                 std::shared_ptr<const std::string> &outData,
+                                 const WfsCallOptions &options) override
+    {
+      if (m_hedger && m_endpoints.size() > 1)
+      {
+        return HedgedDownload(remotePath, outData, options);
+      }
+      return Route(options, true, [&](IWfsClient &client, const WfsCallOptions &callOptions)
+                   { return client.DownloadFileShared(remotePath, outData, callOptions); });
+    }
+
+    WfsResult DeleteFile(const std::string &remotePath, const WfsCallOptions &options) override
+    {
+      return Route(options, false, [&](IWfsClient &client, const WfsCallOptions &callOptions)
+                   { return client.DeleteFile(remotePath, callOptions); });
+    }
+
+    WfsResult RenameFile(const std::string &oldPath, const std::string &newPath,
+                         const WfsCallOptions &options) override
+    {
+      return Route(options, false, [&](IWfsClient &client, const WfsCallOptions &callOptions)
+                   { return client.RenameFile(oldPath, newPath, callOptions); });
+    }
+
+    WfsResult ListDirectory(const std::string &remotePath, WfsDirList &outDirList,
+                            const WfsCallOptions &options) override
+    {
+      return Route(options, true, [&](IWfsClient &client, const WfsCallOptions &callOptions)
+                   { return client.ListDirectory(remotePath, outDirList, callOptions); });
+    }
+
+    WfsResult Stat(const std::string &remotePath, WfsDirItem &outItem) override
+    {
+      return Route(WfsCallOptions(), true, [&](IWfsClient &client, const WfsCallOptions &)
+                   { return client.Stat(remotePath, outItem); });
+    }
+
+    bool Exists(const std::string &remotePath) override
+    {
+      Endpoint &endpoint = Pick(nullptr);
+      OutstandingScope outstanding(endpoint);
+      return endpoint.client->Exists(remotePath);
+    }
+
+    WfsResult Flush() override
+    {
+      WfsResult first = WfsResult::Success();
+      for (auto &endpoint : m_endpoints)
+      {
+        WfsResult result = endpoint->client->Flush();
+        if (!result && first)
+        {
+          first = result;
+        }
+      }
+      if (!first)
+      {
+        SetLastError(first);
+      }
+      return first;
+    }
+
+    int8_t Ping(const WfsCallOptions &options) override
+    {
+      int8_t pong = -1;
+      Route(options, true, [&](IWfsClient &client, const WfsCallOptions &callOptions)
+            {
+              pong = client.Ping(callOptions);
+              return pong == -1 ? WfsResult(false, client.GetLastError()) : WfsResult::Success(); });
+      return pong;
+    }
+
+    bool IsConnected() const override
+    {
+      return std::any_of(m_endpoints.begin(), m_endpoints.end(), [](const auto &endpoint)
+                         { return endpoint->client->IsConnected(); });
+    }
+
+    bool IsAuthenticated() const override
+    {
+      return std::any_of(m_endpoints.begin(), m_endpoints.end(), [](const auto &endpoint)
+                         { return endpoint->client->IsAuthenticated(); });
+    }
+
+    WfsErrorInfo GetLastError() const override
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_lastError.error;
+    }
+
+    WfsMetricsSnapshot GetMetrics() const override
+    {
+      std::vector<WfsMetricsSnapshot> snapshots;
+      for (const auto &endpoint : m_endpoints)
+      {
+        snapshots.push_back(endpoint->client->GetMetrics());
+      }
+      WfsMetricsSnapshot merged = MergeEndpointMetrics(snapshots);
+      if (m_hedger)
+      {
+        merged.hedgedReads = m_hedger->HedgedReads();
+        merged.hedgeWins = m_hedger->HedgeWins();
+      }
+      return merged;
+    }
+
+    void SetSlowRequestThreshold(WfsOpType op, int64_t thresholdMicros) override
+    {
+      for (auto &endpoint : m_endpoints)
+      {
+        endpoint->client->SetSlowRequestThreshold(op, thresholdMicros);
+      }
+    }
+
+    size_t DrainSlowRequests(std::vector<WfsSlowRequest> &outRecords, size_t maxRecords) override
+    {
+      size_t moved = 0;
+      for (auto &endpoint : m_endpoints)
+      {
+        if (moved >= maxRecords)
+        {
+          break;
+        }
+        moved += endpoint->client->DrainSlowRequests(outRecords, maxRecords - moved);
+      }
+      return moved;
+    }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    // Under LowestLatency, every this many calls goes round-robin so the
+    // latency of endpoints that stopped being picked stays current
+    static constexpr uint64_t kRefreshEvery = 64;
+
+    // Weight of a new sample in the latency EWMA
+    static constexpr double kLatencyAlpha = 0.2;
+
+    // Further cooldowns double up to this factor
+    static constexpr int kMaxCooldownShift = 5;
+
+    struct Endpoint
+    {
+      std::shared_ptr<IWfsClient> client;
+      WfsEndpoint address;
+      int weight{1};
+      std::atomic<int64_t> outstanding{0};
+      std::atomic<double> latencyMicros{0}; // EWMA of successful calls, 0 = no sample yet
+      std::atomic<int64_t> avoidUntil{0};   // Clock ticks, set by a failed call
+      std::atomic<int> failures{0};         // consecutive failed calls
+    };
+
+    class OutstandingScope
+    {
+    public:
+      explicit OutstandingScope(Endpoint &endpoint) : m_endpoint(endpoint)
+      {
+        m_endpoint.outstanding.fetch_add(1, std::memory_order_relaxed);
+      }
+      ~OutstandingScope()
+      {
+        m_endpoint.outstanding.fetch_sub(1, std::memory_order_relaxed);
+      }
+      OutstandingScope(const OutstandingScope &) = delete;
+      OutstandingScope &operator=(const OutstandingScope &) = delete;
+
+    private:
+      Endpoint &m_endpoint;
+    };
+
+    // Failures telling that the endpoint rather than the request failed
+    static bool IsEndpointFailure(const WfsResult &result)
+    {
+      return result.error.category == WfsErrorCategory::Transport ||
+             result.error.category == WfsErrorCategory::Unavailable;
+    }
+
+    double Score(const Endpoint &endpoint) const
+    {
+      double load = static_cast<double>(endpoint.outstanding.load(std::memory_order_relaxed) + 1) /
+                    endpoint.weight;
+      if (m_policy == WfsLoadBalancing::LowestLatency)
+      {
+        // Endpoints without a sample yet score 0 and are tried first
+        load *= endpoint.latencyMicros.load(std::memory_order_relaxed);
+      }
+      return load;
+    }
+
+    // Best endpoint other than exclude (which is returned only if it is the
+    // single one); endpoints in cooldown only when all of them are
+    Endpoint &Pick(const Endpoint *exclude)
+    {
+      const int64_t now = Clock::now().time_since_epoch().count();
+      const size_t count = m_endpoints.size();
+      const uint64_t turn = m_turn.fetch_add(1, std::memory_order_relaxed);
+      const bool refresh = m_policy == WfsLoadBalancing::LowestLatency && turn % kRefreshEvery == 0;
+
+      Endpoint *best = nullptr;
+      bool bestAvoided = true;
+      double bestScore = std::numeric_limits<double>::max();
+      for (size_t i = 0; i < count; ++i)
+      {
+        // Start at a rotating offset so ties alternate
+        Endpoint &endpoint = *m_endpoints[(turn + i) % count];
+        if (&endpoint == exclude)
+        {
+          continue;
+        }
+        const bool avoided = endpoint.avoidUntil.load(std::memory_order_relaxed) > now;
+        const double score = refresh ? 0 : Score(endpoint);
+        if (!best || (bestAvoided && !avoided) || (avoided == bestAvoided && score < bestScore))
+        {
+          best = &endpoint;
+          bestAvoided = avoided;
+          bestScore = score;
+        }
+      }
+      return best ? *best : *m_endpoints.front();
+    }
+
+    template <typename Call>
+    WfsResult Invoke(Endpoint &endpoint, const WfsCallOptions &options, const CallDeadline &call, Call &&callClient)
+    {
+      const auto start = Clock::now();
+      WfsResult result;
+      {
+        OutstandingScope outstanding(endpoint);
+        result = callClient(*endpoint.client, options);
+      }
+
+      if (result)
+      {
+        const double micros = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        const double previous = endpoint.latencyMicros.load(std::memory_order_relaxed);
+        endpoint.latencyMicros.store(previous > 0 ? (1 - kLatencyAlpha) * previous + kLatencyAlpha * micros
+                                                  : std::max(micros, 1.0),
+                                     std::memory_order_relaxed);
+        endpoint.failures.store(0, std::memory_order_relaxed);
+      }
+      else if (IsEndpointFailure(result) && call.Status())
+      {
+        // Not the caller's own deadline or cancellation: the endpoint is sick
+        const int failures = endpoint.failures.fetch_add(1, std::memory_order_relaxed);
+        const auto cooldown = m_cooldown * (1 << std::min(failures, kMaxCooldownShift));
+        endpoint.avoidUntil.store((Clock::now() + cooldown).time_since_epoch().count(),
+                                  std::memory_order_relaxed);
+        WFS_LOG_WARN("Endpoint {} avoided for {} ms: {}", EndpointName(endpoint.address),
+                     cooldown.count(), result.error.info);
+      }
+      return result;
+    }
+
+    // Call on the best endpoint; with failover, once more on the next best
+    // if the first one failed in the transport
+    template <typename Call>
+    WfsResult Route(const WfsCallOptions &options, bool failover, Call &&callClient)
+    {
+      const CallDeadline call(options);
+      Endpoint &first = Pick(nullptr);
+      WfsResult result = Invoke(first, options, call, callClient);
+
+      if (!result && failover && m_endpoints.size() > 1 && IsEndpointFailure(result) && call.Status())
+      {
+        Endpoint &second = Pick(&first);
+        WFS_LOG_INFO("Failing over from {} to {}", EndpointName(first.address), EndpointName(second.address));
+        result = Invoke(second, call.RemainingOptions(), call, callClient);
+      }
+
+      if (!result)
+      {
+        SetLastError(result);
+      }
+      return result;
+    }
+
+    // Download racing the best endpoint against the next best one
+    WfsResult HedgedDownload(const std::string &remotePath, std::shared_ptr<const std::string> &outData,
+                             const WfsCallOptions &options)
+    {
+      const CallDeadline call(options);
+      Endpoint *first = &Pick(nullptr);
+      auto attempt = [this, first, remotePath](int index, const WfsCallOptions &attemptOptions,
+                                               std::shared_ptr<const std::string> &data)
+      {
+        // A cancelled loser fails its own deadline, not the endpoint's health
+        return Invoke(index == 0 ? *first : Pick(first), attemptOptions, CallDeadline(attemptOptions),
+                      [&](IWfsClient &client, const WfsCallOptions &callOptions)
+                      { return client.DownloadFileShared(remotePath, data, callOptions); });
+      };
+      WfsResult result = m_hedger->Read(true, call, std::move(attempt), IsEndpointFailure, outData);
+      if (!result)
+      {
+        SetLastError(result);
+      }
+      return result;
+    }
+
+    // Apply to every endpoint; succeeds if any endpoint does
+    template <typename Call>
+    WfsResult ForAll(Call &&callClient)
+    {
+      WfsResult result = WfsResult::Failure(-1, "No endpoints configured");
+      for (auto &endpoint : m_endpoints)
+      {
+        WfsResult endpointResult = callClient(*endpoint->client, endpoint->address);
+        if (endpointResult)
+        {
+          result = endpointResult;
+        }
+        else
+        {
+          WFS_LOG_WARN("Endpoint {}: {}", EndpointName(endpoint->address), endpointResult.error.info);
+          if (!result)
+          {
+            result = endpointResult;
+          }
+        }
+      }
+      if (!result)
+      {
+        SetLastError(result);
+      }
+      return result;
+    }
+
+    void SetLastError(const WfsResult &result)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_lastError = result;
+    }
+
+    // Fixed at creation, read-only afterwards
+    std::vector<std::unique_ptr<Endpoint>> m_endpoints;
+
+    // Set by Connect
+    WfsLoadBalancing m_policy{WfsLoadBalancing::LeastOutstanding};
+    std::chrono::milliseconds m_cooldown{1000};
+    bool m_retryAppend{false};
+
+    std::atomic<uint64_t> m_turn{0};
+
+    // Set by Connect with hedging; destroyed first, joining its attempts
+    std::unique_ptr<HedgedReader> m_hedger;
+
+    mutable std::mutex m_mutex;
+    WfsResult m_lastError;
+  };
+
+} // namespace wfs_client
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <thrift/transport/TTransportException.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "wfs_client/call_options.hpp"
+#include "wfs_client/datatype_.hpp"
+
+namespace wfs_client
+{
+
+  // Deadline and cancellation token of one client call. The deadline is
+  // fixed when the call enters the client, so waiting for the client lock,
+  // every attempt and the backoff between attempts all count against it.
+  class CallDeadline
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // How often waits without a socket-level timeout look at the token
+    static constexpr std::chrono::milliseconds kPollInterval{20};
+
+    CallDeadline() = default;
+
+    explicit CallDeadline(const WfsCallOptions &options)
+        : m_cancel(options.cancel)
+    {
+      if (options.timeout > 0)
+      {
+        m_deadline = Clock::now() + std::chrono::milliseconds(options.timeout);
+        m_hasDeadline = true;
+      }
+    }
+
+    // Whether the call has a deadline or a token at all
+    bool Bounded() const
+    {
+      return m_hasDeadline || m_cancel;
+    }
+
+    bool Cancellable() const
+    {
+      return m_cancel != nullptr;
+    }
+
+    bool Cancelled() const
+    {
+      return m_cancel && m_cancel->IsCancelled();
+    }
+
+    bool Expired() const
+    {
+      return m_hasDeadline && Clock::now() >= m_deadline;
+    }
+
+    // Time left, Clock::duration::max() without a deadline
+    Clock::duration Remaining() const
+    {
+      if (!m_hasDeadline)
+      {
+        return Clock::duration::max();
+      }
+      return std::max(Clock::duration::zero(), m_deadline - Clock::now());
+    }
+
+    // Failure telling why the call has to stop, success while it may go on
+    WfsResult Status() const
+    {
+      if (Cancelled())
+      {
+        return WfsResult::Failure(-1, "Call cancelled", WfsErrorCategory::Cancelled);
+      }
+      if (Expired())
+      {
+        return WfsResult::Failure(-1, "Call deadline exceeded", WfsErrorCategory::DeadlineExceeded);
+      }
+      return WfsResult::Success();
+    }
+
+    // Abort the exchange in progress from inside the transport stack
+    void Check() const
+    {
+      using apache::thrift::transport::TTransportException;
+      if (Cancelled())
+      {
+        throw TTransportException(TTransportException::INTERRUPTED, "Call cancelled");
+      }
+      if (Expired())
+      {
+        throw TTransportException(TTransportException::TIMED_OUT, "Call deadline exceeded");
+      }
+    }
+
+    // The same token without the deadline, for work that outlives the call
+    CallDeadline CancellationOnly() const
+    {
+      CallDeadline cancellation;
+      cancellation.m_cancel = m_cancel;
+      return cancellation;
+    }
+
+    bool SameToken(const CallDeadline &other) const
+    {
+      return m_cancel == other.m_cancel;
+    }
+
+    // Options giving a further call the time left and the same token
+    WfsCallOptions RemainingOptions() const
+    {
+      WfsCallOptions options;
+      options.cancel = m_cancel;
+      if (m_hasDeadline)
+      {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(Remaining()).count();
+        options.timeout = static_cast<int>(std::clamp<int64_t>(left, 1, INT32_MAX));
+      }
+      return options;
+    }
+
+    // Sleep for up to duration; false if the call had to stop meanwhile
+    bool SleepFor(Clock::duration duration) const
+    {
+      const auto until = Clock::now() + duration;
+      for (;;)
+      {
+        if (!Status())
+        {
+          return false;
+        }
+        const auto now = Clock::now();
+        if (now >= until)
+        {
+          return true;
+        }
+        std::this_thread::sleep_for(Bounded() ? std::min<Clock::duration>(until - now, kPollInterval)
+                                              : until - now);
+      }
+    }
+
+  private:
+    Clock::time_point m_deadline;
+    bool m_hasDeadline{false};
+    std::shared_ptr<const WfsCancellationToken> m_cancel;
+  };
+
+} // namespace wfs_client
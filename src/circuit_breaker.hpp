@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "wfs_client/datatype_.hpp"
+#include "wfs_client/metrics.hpp"
+#include "wfs_log.hpp"
+
+namespace wfs_client
+{
+
+  // Circuit breaker of one server endpoint. Closed, it records the outcome
+  // of every call in a rolling window and opens when the failure rate
+  // reaches the policy's threshold. Open, it rejects calls until
+  // openDuration has passed; the next caller is then admitted as the probe
+  // (half-open) while everyone else is still rejected, and the probe's
+  // outcome closes the breaker or opens it for another period. Thread-safe:
+  // rejected callers never wait for the client lock.
+  class CircuitBreaker
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Admission
+    {
+      Allow,
+      Reject,
+      Probe // the caller must probe the server and report OnProbe()
+    };
+
+    explicit CircuitBreaker(const WfsCircuitBreakerPolicy &policy)
+        : m_window(static_cast<size_t>(std::max(1, policy.window))),
+          m_minCalls(static_cast<size_t>(std::clamp(policy.minCalls, 1, std::max(1, policy.window)))),
+          m_failureRate(policy.failureRate),
+          m_openDuration(std::chrono::milliseconds(std::max(0, policy.openDuration))),
+          m_outcomes(m_window, false)
+    {
+    }
+
+    Admission Admit()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_state == WfsBreakerState::Closed)
+      {
+        return Admission::Allow;
+      }
+      if (m_state == WfsBreakerState::Open && Clock::now() >= m_openUntil)
+      {
+        Transition(WfsBreakerState::HalfOpen);
+        return Admission::Probe;
+      }
+      ++m_rejected;
+      return Admission::Reject;
+    }
+
+    // Outcome of an admitted call; false for failures that point at the
+    // server or the network
+    void Record(bool success)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_state != WfsBreakerState::Closed)
+      {
+        // Admitted before the breaker opened
+        return;
+      }
+
+      if (m_count == m_window)
+      {
+        m_failures -= m_outcomes[m_next] ? 1 : 0;
+      }
+      else
+      {
+        ++m_count;
+      }
+      m_outcomes[m_next] = !success;
+      m_failures += success ? 0 : 1;
+      m_next = (m_next + 1) % m_window;
+
+      if (m_count >= m_minCalls &&
+          static_cast<double>(m_failures) >= m_failureRate * static_cast<double>(m_count))
+      {
+        WFS_LOG_WARN("Circuit breaker opened: {}/{} recent calls failed", m_failures, m_count);
+        Open();
+      }
+    }
+
+    // Result of the probe of an Admission::Probe caller
+    void OnProbe(bool success)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_state != WfsBreakerState::HalfOpen)
+      {
+        return;
+      }
+      if (success)
+      {
+        WFS_LOG_INFO("Circuit breaker closed: trial ping succeeded");
+        std::fill(m_outcomes.begin(), m_outcomes.end(), false);
+        m_count = 0;
+        m_failures = 0;
+        m_next = 0;
+        Transition(WfsBreakerState::Closed);
+      }
+      else
+      {
+        WFS_LOG_WARN("Circuit breaker stays open: trial ping failed");
+        Open();
+      }
+    }
+
+    // The probe could not run (e.g. its caller's deadline passed first);
+    // the next caller probes instead
+    void AbandonProbe()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_state == WfsBreakerState::HalfOpen)
+      {
+        // m_openUntil has passed: the next Admit() probes
+        Transition(WfsBreakerState::Open);
+      }
+    }
+
+    void Snapshot(WfsMetricsSnapshot &snapshot) const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      snapshot.breakerState = m_state;
+      snapshot.breakerTransitions = m_transitions;
+      snapshot.breakerRejected = m_rejected;
+    }
+
+  private:
+    void Open()
+    {
+      m_openUntil = Clock::now() + m_openDuration;
+      Transition(WfsBreakerState::Open);
+    }
+
+    void Transition(WfsBreakerState state)
+    {
+      m_state = state;
+      ++m_transitions[static_cast<size_t>(state)];
+    }
+
+    const size_t m_window;
+    const size_t m_minCalls;
+    const double m_failureRate;
+    const Clock::duration m_openDuration;
+
+    mutable std::mutex m_mutex;
+    WfsBreakerState m_state{WfsBreakerState::Closed};
+    Clock::time_point m_openUntil;
+
+    // Rolling window of outcomes, true = failure
+    std::vector<bool> m_outcomes;
+    size_t m_next{0};
+    size_t m_count{0};
+    size_t m_failures{0};
+
+    std::array<uint64_t, kWfsBreakerStateCount> m_transitions{};
+    uint64_t m_rejected{0};
+  };
+
+} // namespace wfs_client
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <thrift/transport/TSocket.h>
+#include <thrift/transport/TTransportException.h>
+#include <thrift/transport/TVirtualTransport.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "call_deadline.hpp"
+#include "rtt_estimator.hpp"
+#include "wfs_client/datatype_.hpp"
+
+namespace wfs_client
+{
+
+  // Pass-through transport just above the socket that holds the exchange in
+  // progress to the current call's deadline and cancellation token (*call,
+  // owned by the client and set under its lock). Socket waits are cut into
+  // slices bounded by the time left and, with a token, by the poll interval;
+  // a timed out slice read nothing, so the read is simply repeated. Writes go
+  // out in chunks so a large upload stops between two of them. The
+  // connection's own timeouts still apply to every wait, and connects made
+  // on behalf of a bounded call are bounded too.
+  //
+  // With an RttEstimator, reply waits are further bounded by its adaptive
+  // timeout: the wait for a reply's first byte by the timeout for the
+  // request's size, later waits within the reply by the bare RTT timeout.
+  // The estimator learns from the flush-to-first-byte time of every reply.
+  class DeadlineTransport : public apache::thrift::transport::TVirtualTransport<DeadlineTransport>
+  {
+  public:
+    static constexpr uint32_t kWriteChunk = 64 * 1024;
+
+    DeadlineTransport(std::shared_ptr<apache::thrift::transport::TTransport> inner,
+                      std::shared_ptr<apache::thrift::transport::TSocket> socket,
+                      const CallDeadline *call, RttEstimator *rtt, const WfsConnectionParams &params)
+        : TVirtualTransport(inner->getConfiguration()), m_inner(std::move(inner)),
+          m_socket(std::move(socket)), m_call(call), m_rtt(rtt),
+          m_connectTimeout(params.connectTimeout),
+          m_receiveTimeout(params.receiveTimeout),
+          m_sendTimeout(params.sendTimeout)
+    {
+    }
+
+    bool isOpen() const override
+    {
+      return m_inner->isOpen();
+    }
+
+    bool peek() override
+    {
+      return m_inner->peek();
+    }
+
+    void open() override
+    {
+      if (m_call->Bounded())
+      {
+        // Reconnects between attempts of a bounded call
+        m_call->Check();
+        auto limit = m_call->Remaining();
+        if (m_connectTimeout.count() > 0)
+        {
+          limit = std::min<Clock::duration>(limit, m_connectTimeout);
+        }
+        SetSocketTimeout(&apache::thrift::transport::TSocket::setConnTimeout, limit);
+      }
+      m_inner->open();
+    }
+
+    void close() override
+    {
+      m_inner->close();
+    }
+
+    uint32_t read(uint8_t *buf, uint32_t len)
+    {
+      const bool firstByte = m_awaitingReply;
+      std::chrono::milliseconds limit = m_receiveTimeout;
+      bool adaptive = false;
+      if (m_rtt)
+      {
+        const auto timeout = m_rtt->Timeout(firstByte ? m_requestBytes : 0);
+        if (timeout.count() > 0 && (limit.count() <= 0 || timeout < limit))
+        {
+          limit = timeout;
+          adaptive = true;
+        }
+      }
+
+      uint32_t got = 0;
+      if (!m_call->Bounded() && !adaptive)
+      {
+        RestoreTimeouts();
+        got = m_inner->read(buf, len);
+      }
+      else
+      {
+        got = SlicedRead(buf, len, limit, adaptive);
+      }
+
+      m_replying = true;
+      if (firstByte)
+      {
+        m_awaitingReply = false;
+        if (m_rtt)
+        {
+          m_rtt->AddSample(Clock::now() - m_flushedAt, m_requestBytes);
+        }
+      }
+      return got;
+    }
+
+    void write(const uint8_t *buf, uint32_t len)
+    {
+      if (m_replying)
+      {
+        // A new request starts the next exchange
+        m_replying = false;
+        m_requestBytes = 0;
+      }
+      m_requestBytes += len;
+
+      if (!m_call->Bounded())
+      {
+        RestoreTimeouts();
+        m_inner->write(buf, len);
+        return;
+      }
+
+      while (len > 0)
+      {
+        m_call->Check();
+        auto limit = m_call->Remaining();
+        if (m_sendTimeout.count() > 0)
+        {
+          limit = std::min<Clock::duration>(limit, m_sendTimeout);
+        }
+        SetSocketTimeout(&apache::thrift::transport::TSocket::setSendTimeout, limit);
+
+        const uint32_t chunk = std::min(len, kWriteChunk);
+        m_inner->write(buf, chunk);
+        buf += chunk;
+        len -= chunk;
+      }
+    }
+
+    void flush() override
+    {
+      m_inner->flush();
+      m_flushedAt = Clock::now();
+      m_awaitingReply = true;
+    }
+
+    uint32_t readEnd() override
+    {
+      return m_inner->readEnd();
+    }
+
+    uint32_t writeEnd() override
+    {
+      return m_inner->writeEnd();
+    }
+
+    const std::string getOrigin() const override
+    {
+      return m_inner->getOrigin();
+    }
+
+  private:
+    using Clock = CallDeadline::Clock;
+
+    // Read in socket waits no longer than the call allows, until data
+    // arrives or limit (0 = none) has passed since the read started
+    uint32_t SlicedRead(uint8_t *buf, uint32_t len, std::chrono::milliseconds limit, bool adaptive)
+    {
+      using apache::thrift::transport::TTransportException;
+
+      const auto waitStart = Clock::now();
+      for (;;)
+      {
+        m_call->Check();
+        auto slice = m_call->Remaining();
+        if (m_call->Cancellable())
+        {
+          slice = std::min<Clock::duration>(slice, CallDeadline::kPollInterval);
+        }
+        if (limit.count() > 0)
+        {
+          slice = std::min<Clock::duration>(slice, limit - (Clock::now() - waitStart));
+        }
+        SetSocketTimeout(&apache::thrift::transport::TSocket::setRecvTimeout, slice);
+
+        try
+        {
+          return m_inner->read(buf, len);
+        }
+        catch (const TTransportException &e)
+        {
+          if (e.getType() != TTransportException::TIMED_OUT)
+          {
+            throw;
+          }
+          if (limit.count() > 0 && Clock::now() - waitStart >= limit)
+          {
+            if (!adaptive)
+            {
+              throw;
+            }
+            m_rtt->OnTimeout();
+            throw TTransportException(TTransportException::TIMED_OUT,
+                                      "No reply within the adaptive timeout of " +
+                                          std::to_string(limit.count()) + " ms");
+          }
+        }
+      }
+    }
+
+    void SetSocketTimeout(void (apache::thrift::transport::TSocket::*setter)(int), Clock::duration timeout)
+    {
+      // 0 would mean no timeout at all
+      const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count();
+      ((*m_socket).*setter)(static_cast<int>(std::clamp<int64_t>(ms, 1, INT32_MAX)));
+      m_narrowed = true;
+    }
+
+    void RestoreTimeouts()
+    {
+      if (m_narrowed)
+      {
+        m_socket->setConnTimeout(static_cast<int>(m_connectTimeout.count()));
+        m_socket->setRecvTimeout(static_cast<int>(m_receiveTimeout.count()));
+        m_socket->setSendTimeout(static_cast<int>(m_sendTimeout.count()));
+        m_narrowed = false;
+      }
+    }
+
+    std::shared_ptr<apache::thrift::transport::TTransport> m_inner;
+    std::shared_ptr<apache::thrift::transport::TSocket> m_socket;
+    const CallDeadline *m_call;
+    RttEstimator *m_rtt; // optional, adaptive timeouts
+    const std::chrono::milliseconds m_connectTimeout;
+    const std::chrono::milliseconds m_receiveTimeout;
+    const std::chrono::milliseconds m_sendTimeout;
+    bool m_narrowed{false}; // socket timeouts currently narrowed for a bounded call
+
+    // Exchange in progress
+    uint64_t m_requestBytes{0};
+    Clock::time_point m_flushedAt;
+    bool m_awaitingReply{false}; // flushed, first reply byte not read yet
+    bool m_replying{false};      // reply bytes read since the last write
+  };
+
+} // namespace wfs_client
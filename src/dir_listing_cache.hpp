@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "wfs_client/datatype_.hpp"
+#include "wfs_client/utils.hpp"
+
+namespace wfs_client
+{
+
+  // Cache of directory listings indexed by entry name, so Stat/Exists resolve
+  // a path in O(1) instead of scanning or re-fetching the parent directory
+  class DirListingCache
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Lookup
+    {
+      Hit,     // Entry found in a fresh listing
+      Missing, // Fresh listing exists but has no such entry
+      Stale    // No listing cached or it has expired
+    };
+
+    // Upper bound on cached directories before expired ones are evicted
+    static constexpr size_t kMaxDirectories = 4096;
+
+    explicit DirListingCache(std::chrono::milliseconds ttl = std::chrono::milliseconds(0))
+        : m_ttl(ttl)
+    {
+    }
+
+    void SetTtl(std::chrono::milliseconds ttl)
+    {
+      std::unique_lock<std::shared_mutex> lock(m_mutex);
+      m_ttl = ttl;
+      m_dirs.clear();
+    }
+
+    bool Enabled() const
+    {
+      std::shared_lock<std::shared_mutex> lock(m_mutex);
+      return m_ttl.count() > 0;
+    }
+
+    // Current invalidation generation, captured before a listing is fetched
+    uint64_t Generation() const
+    {
+      return m_generation.load(std::memory_order_acquire);
+    }
+
+    Lookup Find(const std::string &dir, const std::string &name, WfsDirItem &outItem) const
+    {
+      std::shared_lock<std::shared_mutex> lock(m_mutex);
+      auto it = m_dirs.find(dir);
+      if (it == m_dirs.end() || Clock::now() - it->second->fetchedAt >= m_ttl)
+      {
+        return Lookup::Stale;
+      }
+
+      auto item = it->second->items.find(name);
+      if (item == it->second->items.end())
+      {
+        return Lookup::Missing;
+      }
+      outItem = item->second;
+      return Lookup::Hit;
+    }
+
+    // Store a listing fetched while the cache was at the given generation;
+    // listings that raced with an invalidation are dropped
+    void Store(const std::string &dir, const WfsDirList &dirList, uint64_t generation)
+    {
+      auto entry = std::make_shared<Entry>();
+      entry->fetchedAt = Clock::now();
+      entry->items.reserve(dirList.items.size());
+      for (const auto &item : dirList.items)
+      {
+        entry->items.emplace(utils::getFileName(item.name), item);
+      }
+
+      std::unique_lock<std::shared_mutex> lock(m_mutex);
+      if (m_ttl.count() <= 0 || generation != Generation())
+      {
+        return;
+      }
+      if (m_dirs.size() >= kMaxDirectories && m_dirs.find(dir) == m_dirs.end())
+      {
+        EvictExpired(entry->fetchedAt);
+        if (m_dirs.size() >= kMaxDirectories)
+        {
+          m_dirs.clear();
+        }
+      }
+      m_dirs[dir] = std::move(entry);
+    }
+
+    void Invalidate(const std::string &dir)
+    {
+      std::unique_lock<std::shared_mutex> lock(m_mutex);
+      m_generation.fetch_add(1, std::memory_order_acq_rel);
+      m_dirs.erase(dir);
+    }
+
+    void Clear()
+    {
+      std::unique_lock<std::shared_mutex> lock(m_mutex);
+      m_generation.fetch_add(1, std::memory_order_acq_rel);
+      m_dirs.clear();
+    }
+
+  private:
+    struct Entry
+    {
+      Clock::time_point fetchedAt;
+      std::unordered_map<std::string, WfsDirItem> items;
+    };
+
+    void EvictExpired(Clock::time_point now)
+    {
+      for (auto it = m_dirs.begin(); it != m_dirs.end();)
+      {
+        if (now - it->second->fetchedAt >= m_ttl)
+        {
+          it = m_dirs.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+
+    mutable std::shared_mutex m_mutex;
+    std::chrono::milliseconds m_ttl;
+    std::atomic<uint64_t> m_generation{0};
+    std::unordered_map<std::string, std::shared_ptr<const Entry>> m_dirs;
+  };
+
+} // namespace wfs_client
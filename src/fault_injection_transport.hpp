@@ -0,0 +1,264 @@
+#pragma once
+
+#include <thrift/transport/TTransportException.h>
+#include <thrift/transport/TVirtualTransport.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "wfs_client/fault_injection.hpp"
+
+namespace wfs_client
+{
+
+  // Armed fault shared by every connection built with the injector
+  class FaultInjector : public IWfsFaultInjector
+  {
+  public:
+    enum class Action
+    {
+      None,
+      Drop,
+      Corrupt
+    };
+
+    void Arm(WfsFaultType type, int64_t afterBytes, int count) override
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_type = type;
+      m_remainingBytes = afterBytes > 0 ? afterBytes : 0;
+      m_count = count > 0 ? count : 1;
+    }
+
+    void Disarm() override
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_type = WfsFaultType::None;
+    }
+
+    WfsFaultStats Stats() const override
+    {
+      WfsFaultStats stats;
+      stats.injected = m_injected.load(std::memory_order_relaxed);
+      stats.wastedBytes = m_wastedBytes.load(std::memory_order_relaxed);
+      stats.bytesSent = m_bytesSent.load(std::memory_order_relaxed);
+      stats.bytesReceived = m_bytesReceived.load(std::memory_order_relaxed);
+      return stats;
+    }
+
+    // Connection attempt; true to refuse it
+    bool OnConnect()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_type != WfsFaultType::RefuseConnect)
+      {
+        return false;
+      }
+      if (--m_count <= 0)
+      {
+        m_type = WfsFaultType::None;
+      }
+      m_injected.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+
+    // len bytes about to be transferred; returns the fault to apply and, in
+    // offset, how many of them pass before it
+    Action OnTransfer(uint32_t len, bool reading, uint32_t &offset)
+    {
+      (reading ? m_bytesReceived : m_bytesSent).fetch_add(len, std::memory_order_relaxed);
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_type != WfsFaultType::DropConnection && m_type != WfsFaultType::CorruptFrame)
+      {
+        return Action::None;
+      }
+      // Corruption hits replies only, a garbled request would be the server's problem
+      if (m_type == WfsFaultType::CorruptFrame && !reading)
+      {
+        m_remainingBytes = m_remainingBytes > len ? m_remainingBytes - len : 0;
+        return Action::None;
+      }
+      if (m_remainingBytes > len)
+      {
+        m_remainingBytes -= len;
+        return Action::None;
+      }
+      offset = static_cast<uint32_t>(m_remainingBytes);
+      const Action action = m_type == WfsFaultType::DropConnection ? Action::Drop : Action::Corrupt;
+      m_type = WfsFaultType::None;
+      m_injected.fetch_add(1, std::memory_order_relaxed);
+      return action;
+    }
+
+    // Next reply; true if it must time out
+    bool OnReply()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_type != WfsFaultType::Timeout)
+      {
+        return false;
+      }
+      m_type = WfsFaultType::None;
+      m_injected.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+
+    void AddWasted(uint64_t bytes)
+    {
+      m_wastedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+  private:
+    std::mutex m_mutex;
+    WfsFaultType m_type{WfsFaultType::None};
+    int64_t m_remainingBytes{0};
+    int m_count{0};
+
+    std::atomic<uint64_t> m_injected{0};
+    std::atomic<uint64_t> m_wastedBytes{0};
+    std::atomic<uint64_t> m_bytesSent{0};
+    std::atomic<uint64_t> m_bytesReceived{0};
+  };
+
+  // Pass-through transport just above the socket that fires the injector's
+  // armed fault. Bytes of the request/reply exchange in progress when a
+  // fault fires are reported as wasted: they have to be sent again.
+  class FaultInjectionTransport : public apache::thrift::transport::TVirtualTransport<FaultInjectionTransport>
+  {
+  public:
+    FaultInjectionTransport(std::shared_ptr<apache::thrift::transport::TTransport> inner,
+                            std::shared_ptr<FaultInjector> injector, int receiveTimeoutMs)
+        : TVirtualTransport(inner->getConfiguration()), m_inner(std::move(inner)),
+          m_injector(std::move(injector)), m_receiveTimeout(std::chrono::milliseconds(receiveTimeoutMs))
+    {
+    }
+
+    bool isOpen() const override
+    {
+      return m_inner->isOpen();
+    }
+
+    bool peek() override
+    {
+      return m_inner->peek();
+    }
+
+    void open() override
+    {
+      if (m_injector->OnConnect())
+      {
+        throw apache::thrift::transport::TTransportException(
+            apache::thrift::transport::TTransportException::NOT_OPEN, "Injected fault: connection refused");
+      }
+      m_inner->open();
+      m_exchangeBytes = 0;
+      m_replying = false;
+    }
+
+    void close() override
+    {
+      m_inner->close();
+    }
+
+    uint32_t read(uint8_t *buf, uint32_t len)
+    {
+      if (!m_replying)
+      {
+        m_replying = true;
+        if (m_injector->OnReply())
+        {
+          Waste(0);
+          std::this_thread::sleep_for(m_receiveTimeout);
+          throw apache::thrift::transport::TTransportException(
+              apache::thrift::transport::TTransportException::TIMED_OUT, "Injected fault: reply timed out");
+        }
+      }
+
+      const uint32_t got = m_inner->read(buf, len);
+      uint32_t offset = 0;
+      switch (m_injector->OnTransfer(got, true, offset))
+      {
+      case FaultInjector::Action::Drop:
+        Waste(offset);
+        m_inner->close();
+        throw apache::thrift::transport::TTransportException(
+            apache::thrift::transport::TTransportException::END_OF_FILE, "Injected fault: connection reset");
+      case FaultInjector::Action::Corrupt:
+        for (uint32_t i = offset; i < got; ++i)
+        {
+          buf[i] = static_cast<uint8_t>(~buf[i]);
+        }
+        Waste(got);
+        break;
+      default:
+        m_exchangeBytes += got;
+        break;
+      }
+      return got;
+    }
+
+    void write(const uint8_t *buf, uint32_t len)
+    {
+      if (m_replying)
+      {
+        // A new request starts the next exchange
+        m_replying = false;
+        m_exchangeBytes = 0;
+      }
+
+      uint32_t offset = 0;
+      if (m_injector->OnTransfer(len, false, offset) == FaultInjector::Action::Drop)
+      {
+        if (offset > 0)
+        {
+          m_inner->write(buf, offset);
+        }
+        Waste(offset);
+        m_inner->close();
+        throw apache::thrift::transport::TTransportException(
+            apache::thrift::transport::TTransportException::NOT_OPEN, "Injected fault: connection reset");
+      }
+      m_inner->write(buf, len);
+      m_exchangeBytes += len;
+    }
+
+    void flush() override
+    {
+      m_inner->flush();
+    }
+
+    uint32_t readEnd() override
+    {
+      return m_inner->readEnd();
+    }
+
+    uint32_t writeEnd() override
+    {
+      return m_inner->writeEnd();
+    }
+
+    const std::string getOrigin() const override
+    {
+      return m_inner->getOrigin();
+    }
+
+  private:
+    void Waste(uint64_t extraBytes)
+    {
+      m_injector->AddWasted(m_exchangeBytes + extraBytes);
+      m_exchangeBytes = 0;
+    }
+
+    std::shared_ptr<apache::thrift::transport::TTransport> m_inner;
+    std::shared_ptr<FaultInjector> m_injector;
+    std::chrono::milliseconds m_receiveTimeout;
+    uint64_t m_exchangeBytes{0};
+    bool m_replying{false};
+  };
+
+} // namespace wfs_client
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "wfs_client/datatype_.hpp"
+#include "multi_endpoint.hpp"
+
+namespace wfs_client
+{
+
+  // Consistent hash ring over a set of nodes. Every node is placed at
+  // virtualNodes * weight points derived from its "ip:port" alone, so a
+  // node keeps its points whatever other nodes join or leave, and a key
+  // belongs to the nodes whose points follow its hash clockwise. Immutable.
+  class HashRing
+  {
+  public:
+    HashRing(const std::vector<WfsEndpoint> &nodes, int virtualNodes)
+        : m_nodeCount(nodes.size())
+    {
+      const int perWeight = std::max(1, virtualNodes);
+      for (size_t node = 0; node < nodes.size(); ++node)
+      {
+        const std::string name = EndpointName(nodes[node]);
+        const int points = perWeight * std::max(1, nodes[node].weight);
+        for (int i = 0; i < points; ++i)
+        {
+          m_points.emplace_back(Hash(name + "#" + std::to_string(i)), static_cast<uint32_t>(node));
+        }
+      }
+      std::sort(m_points.begin(), m_points.end());
+    }
+
+    // Indices of the first count distinct nodes clockwise from key's hash,
+    // in ring order (fewer if the ring has fewer nodes)
+    void Owners(std::string_view key, size_t count, std::vector<size_t> &outNodes) const
+    {
+      outNodes.clear();
+      if (m_points.empty())
+      {
+        return;
+      }
+      count = std::min(count, m_nodeCount);
+
+      const uint64_t hash = Hash(key);
+      auto it = std::lower_bound(m_points.begin(), m_points.end(), std::make_pair(hash, uint32_t{0}));
+      for (size_t seen = 0; seen < m_points.size() && outNodes.size() < count; ++seen, ++it)
+      {
+        if (it == m_points.end())
+        {
+          it = m_points.begin();
+        }
+        if (std::find(outNodes.begin(), outNodes.end(), it->second) == outNodes.end())
+        {
+          outNodes.push_back(it->second);
+        }
+      }
+    }
+
+    // 64-bit FNV-1a with a splitmix64 finalizer, so similar names (and the
+    // virtual node suffixes) spread over the whole ring
+    static uint64_t Hash(std::string_view key)
+    {
+      uint64_t hash = 0xcbf29ce484222325ull;
+      for (const char c : key)
+      {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ull;
+      }
+      hash ^= hash >> 30;
+      hash *= 0xbf58476d1ce4e5b9ull;
+      hash ^= hash >> 27;
+      hash *= 0x94d049bb133111ebull;
+      hash ^= hash >> 31;
+      return hash;
+    }
+
+  private:
+    size_t m_nodeCount;
+    std::vector<std::pair<uint64_t, uint32_t>> m_points; // sorted by hash
+  };
+
+} // namespace wfs_client
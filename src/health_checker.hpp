@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace wfs_client
+{
+
+  // Background thread calling check every interval until destroyed
+  class HealthChecker
+  {
+  public:
+    HealthChecker(std::function<void()> check, std::chrono::milliseconds interval)
+        : m_check(std::move(check)), m_interval(interval)
+    {
+      m_worker = std::thread([this]()
+                             { Run(); });
+    }
+
+    ~HealthChecker()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+      }
+      m_cv.notify_all();
+      if (m_worker.joinable())
+      {
+        m_worker.join();
+      }
+    }
+
+    HealthChecker(const HealthChecker &) = delete;
+    HealthChecker &operator=(const HealthChecker &) = delete;
+
+  private:
+    void Run()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      for (;;)
+      {
+        if (m_cv.wait_for(lock, m_interval, [this]()
+                          { return m_stopping; }))
+        {
+          return;
+        }
+        lock.unlock();
+        m_check();
+        lock.lock();
+      }
+    }
+
+    std::function<void()> m_check;
+    const std::chrono::milliseconds m_interval;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stopping{false};
+    std::thread m_worker;
+  };
+
+} // namespace wfs_client
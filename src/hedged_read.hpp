@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "wfs_client/call_options.hpp"
+#include "wfs_client/datatype_.hpp"
+#include "call_deadline.hpp"
+
+namespace wfs_client
+{
+
+  // Hedged downloads of a multi-replica client. The download is sent to a
+  // first replica; if it has not answered after the hedge delay (the
+  // configured percentile of recent download latencies) and the budget has
+  // a token left, it is sent to a second replica too. The first success
+  // wins and the other attempt is cancelled through its token and left to
+  // finish in the background. A first attempt failing early moves on to
+  // the second replica at once, without spending budget.
+  //
+  // The budget earns budget tokens per download (at most kMaxTokens) and a
+  // hedge spends one, so hedges stay near that share of the downloads even
+  // when a slow replica makes most of them late.
+  //
+  // A download that cannot be hedged (one replica, too few samples or no
+  // token left) runs on the caller's thread. Otherwise the attempts run on
+  // a pool of worker threads kept for reuse. The hedge delay comes from the
+  // latencies of first attempts; a first attempt that lost the race counts
+  // with the time it had taken so far.
+  class HedgedReader
+  {
+  public:
+    using Clock = CallDeadline::Clock;
+
+    // One attempt: 0 on the first replica, 1 on the second. May run on a
+    // worker thread and outlive the download, so it must not refer to the
+    // caller's stack.
+    using Attempt = std::function<WfsResult(int attempt, const WfsCallOptions &options,
+                                            std::shared_ptr<const std::string> &outData)>;
+
+    // Whether a failed first attempt should be followed by the second
+    using Failover = std::function<bool(const WfsResult &result)>;
+
+    static constexpr size_t kLatencyWindow = 256;
+    static constexpr size_t kMinSamples = 20;
+    static constexpr double kMaxTokens = 10;
+
+    explicit HedgedReader(const WfsHedging &config)
+        : m_percentile(std::clamp(config.delayPercentile, 0.0, 1.0)),
+          m_minDelay(std::chrono::milliseconds(std::max(0, config.minDelay))),
+          m_budget(std::max(0.0, config.budget))
+    {
+    }
+
+    // Attempts still running were cancelled when they lost; wait for them
+    ~HedgedReader()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        m_stopping = true;
+      }
+      m_poolCv.notify_all();
+      for (auto &worker : m_workers)
+      {
+        worker.join();
+      }
+    }
+
+    HedgedReader(const HedgedReader &) = delete;
+    HedgedReader &operator=(const HedgedReader &) = delete;
+
+    // Download through attempt, hedging onto the second replica if
+    // canHedge; call holds the caller's deadline and token
+    WfsResult Read(bool canHedge, const CallDeadline &call, Attempt attempt, const Failover &failover,
+                   std::shared_ptr<const std::string> &outData)
+    {
+      const auto hedgeDelay = canHedge ? HedgeDelay() : Clock::duration::max();
+      if (!EarnToken() || hedgeDelay == Clock::duration::max())
+      {
+        return ReadInline(canHedge, call, attempt, failover, outData);
+      }
+
+      auto race = std::make_shared<Race>();
+      race->attempt = std::move(attempt);
+      const auto start = Clock::now();
+      Launch(race, 0, call);
+      const auto hedgeAt = start + hedgeDelay;
+
+      std::unique_lock<std::mutex> lock(race->mutex);
+      for (;;)
+      {
+        const int winner = race->Winner();
+        if (winner >= 0)
+        {
+          race->CancelAll();
+          if (!race->done[0] || race->results[0])
+          {
+            // Censored at the win of the hedge if the first attempt is still out
+            RecordLatency(Clock::now() - start);
+          }
+          outData = std::move(race->data[winner]);
+          if (winner == 1 && race->hedged)
+          {
+            m_hedgeWins.fetch_add(1, std::memory_order_relaxed);
+          }
+          return race->results[winner];
+        }
+
+        WfsResult stop = call.Status();
+        if (!stop)
+        {
+          race->CancelAll();
+          return stop;
+        }
+
+        if (race->launched == race->finished)
+        {
+          // Every attempt so far failed
+          const WfsResult &last = race->results[race->launched - 1];
+          if (race->launched == 2 || !canHedge || !failover(last))
+          {
+            return last;
+          }
+          lock.unlock();
+          Launch(race, 1, call);
+          lock.lock();
+          continue;
+        }
+
+        if (race->launched == 1 && Clock::now() >= hedgeAt && !race->budgetRefused)
+        {
+          if (TakeToken())
+          {
+            race->hedged = true;
+            m_hedgedReads.fetch_add(1, std::memory_order_relaxed);
+            lock.unlock();
+            Launch(race, 1, call);
+            lock.lock();
+            continue;
+          }
+          race->budgetRefused = true;
+        }
+
+        auto wakeAt = race->launched == 1 && !race->budgetRefused ? hedgeAt : Clock::time_point::max();
+        if (call.Bounded())
+        {
+          wakeAt = std::min(wakeAt, Clock::now() + std::chrono::duration_cast<Clock::duration>(CallDeadline::kPollInterval));
+        }
+        if (wakeAt == Clock::time_point::max())
+        {
+          race->cv.wait(lock);
+        }
+        else
+        {
+          race->cv.wait_until(lock, wakeAt);
+        }
+      }
+    }
+
+    uint64_t HedgedReads() const
+    {
+      return m_hedgedReads.load(std::memory_order_relaxed);
+    }
+
+    uint64_t HedgeWins() const
+    {
+      return m_hedgeWins.load(std::memory_order_relaxed);
+    }
+
+  private:
+    // Shared by the waiting caller and the attempt threads
+    struct Race
+    {
+      Attempt attempt;
+
+      std::mutex mutex;
+      std::condition_variable cv;
+      int launched{0};
+      int finished{0};
+      bool hedged{false};
+      bool budgetRefused{false};
+      std::array<bool, 2> done{};
+      std::array<WfsResult, 2> results;
+      std::array<std::shared_ptr<const std::string>, 2> data;
+      std::array<std::shared_ptr<WfsCancellationToken>, 2> cancel;
+
+      // First successful attempt, -1 if none yet
+      int Winner() const
+      {
+        for (int i = 0; i < launched; ++i)
+        {
+          if (done[i] && results[i])
+          {
+            return i;
+          }
+        }
+        return -1;
+      }
+
+      void CancelAll()
+      {
+        for (int i = 0; i < launched; ++i)
+        {
+          cancel[i]->Cancel();
+        }
+      }
+    };
+
+    void Launch(const std::shared_ptr<Race> &race, int index, const CallDeadline &call)
+    {
+      WfsCallOptions options = call.RemainingOptions();
+      auto token = std::make_shared<WfsCancellationToken>();
+      options.cancel = token;
+      {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        race->cancel[index] = std::move(token);
+        race->launched = index + 1;
+      }
+
+      Submit([race, index, options]()
+             {
+               std::shared_ptr<const std::string> data;
+               WfsResult result = race->attempt(index, options, data);
+               {
+                 std::lock_guard<std::mutex> lock(race->mutex);
+                 race->results[index] = std::move(result);
+                 race->data[index] = std::move(data);
+                 race->done[index] = true;
+                 ++race->finished;
+               }
+               race->cv.notify_all(); });
+    }
+
+    // Attempts one after the other on the caller's thread, without hedging
+    WfsResult ReadInline(bool canHedge, const CallDeadline &call, const Attempt &attempt, const Failover &failover,
+                         std::shared_ptr<const std::string> &outData)
+    {
+      const auto start = Clock::now();
+      WfsResult result = attempt(0, call.RemainingOptions(), outData);
+      if (result)
+      {
+        RecordLatency(Clock::now() - start);
+        return result;
+      }
+      WfsResult stop = call.Status();
+      if (!stop)
+      {
+        return stop;
+      }
+      if (!canHedge || !failover(result))
+      {
+        return result;
+      }
+      return attempt(1, call.RemainingOptions(), outData);
+    }
+
+    // Run task on an idle worker, starting one if none is idle
+    void Submit(std::function<void()> task)
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        m_tasks.push_back(std::move(task));
+        if (m_idleWorkers < m_tasks.size())
+        {
+          m_workers.emplace_back([this]()
+                                 { WorkerLoop(); });
+        }
+      }
+      m_poolCv.notify_one();
+    }
+
+    void WorkerLoop()
+    {
+      std::unique_lock<std::mutex> lock(m_poolMutex);
+      for (;;)
+      {
+        ++m_idleWorkers;
+        m_poolCv.wait(lock, [this]()
+                      { return m_stopping || !m_tasks.empty(); });
+        --m_idleWorkers;
+        if (m_tasks.empty())
+        {
+          return;
+        }
+        auto task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+      }
+    }
+
+    void RecordLatency(Clock::duration latency)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_latencies[m_next] = latency;
+      m_next = (m_next + 1) % kLatencyWindow;
+      m_count = std::min(m_count + 1, kLatencyWindow);
+      m_delayStale = true;
+    }
+
+    // Percentile of the recent latencies, max() until enough are known
+    Clock::duration HedgeDelay()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_count < kMinSamples)
+      {
+        return Clock::duration::max();
+      }
+      if (m_delayStale)
+      {
+        std::array<Clock::duration, kLatencyWindow> sorted;
+        std::copy_n(m_latencies.begin(), m_count, sorted.begin());
+        const size_t rank = std::min(m_count - 1, static_cast<size_t>(m_percentile * static_cast<double>(m_count)));
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.begin() + m_count);
+        m_delay = std::max<Clock::duration>(sorted[rank], m_minDelay);
+        m_delayStale = false;
+      }
+      return m_delay;
+    }
+
+    // Earn this download's share; whether a hedge could be paid for now
+    bool EarnToken()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_tokens = std::min(kMaxTokens, m_tokens + m_budget);
+      return m_tokens >= 1;
+    }
+
+    bool TakeToken()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_tokens < 1)
+      {
+        return false;
+      }
+      m_tokens -= 1;
+      return true;
+    }
+
+    const double m_percentile;
+    const Clock::duration m_minDelay;
+    const double m_budget;
+
+    std::mutex m_mutex;
+    std::array<Clock::duration, kLatencyWindow> m_latencies{};
+    size_t m_next{0};
+    size_t m_count{0};
+    Clock::duration m_delay{};
+    bool m_delayStale{true};
+    double m_tokens{0};
+
+    std::mutex m_poolMutex;
+    std::condition_variable m_poolCv;
+    std::deque<std::function<void()>> m_tasks;
+    std::vector<std::thread> m_workers;
+    size_t m_idleWorkers{0};
+    bool m_stopping{false};
+
+    std::atomic<uint64_t> m_hedgedReads{0};
+    std::atomic<uint64_t> m_hedgeWins{0};
+  };
+
+} // namespace wfs_client
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "wfs_client/datatype_.hpp"
+#include "wfs_client/metrics.hpp"
+
+namespace wfs_client
+{
+
+  // "ip:port", identifying an endpoint in logs and on the hash ring
+  inline std::string EndpointName(const WfsEndpoint &endpoint)
+  {
+    return endpoint.serverIp + ":" + std::to_string(endpoint.serverPort);
+  }
+
+  // Parameters of the client of one endpoint of a multi-endpoint client:
+  // the endpoint's address and, with a journal, a journal directory of its own
+  inline WfsConnectionParams EndpointParams(const WfsConnectionParams &params, const WfsEndpoint &endpoint)
+  {
+    WfsConnectionParams endpointParams = params;
+    endpointParams.serverIp = endpoint.serverIp;
+    endpointParams.serverPort = endpoint.serverPort;
+    endpointParams.endpoints.clear();
+    endpointParams.sharding.nodes.clear();
+    if (!params.journalDir.empty())
+    {
+      endpointParams.journalDir = params.journalDir + "/" + endpoint.serverIp + "_" +
+                                  std::to_string(endpoint.serverPort);
+    }
+    return endpointParams;
+  }
+
+  inline int BreakerSeverity(WfsBreakerState state)
+  {
+    switch (state)
+    {
+    case WfsBreakerState::Open:
+      return 2;
+    case WfsBreakerState::HalfOpen:
+      return 1;
+    default:
+      return 0;
+    }
+  }
+
+  // Counters of several endpoint clients summed; the breaker state is the
+  // worst of them and the RTT the mean of the measured ones
+  inline WfsMetricsSnapshot MergeEndpointMetrics(const std::vector<WfsMetricsSnapshot> &snapshots)
+  {
+    WfsMetricsSnapshot merged;
+    int64_t rttSum = 0;
+    int64_t rttCount = 0;
+    for (const auto &snapshot : snapshots)
+    {
+      for (size_t op = 0; op < kWfsOpTypeCount; ++op)
+      {
+        WfsOpMetrics &into = merged.ops[op];
+        const WfsOpMetrics &from = snapshot.ops[op];
+        into.calls += from.calls;
+        into.errors += from.errors;
+        into.latency.Merge(from.latency);
+        into.phaseSamples += from.phaseSamples;
+        for (size_t phase = 0; phase < kWfsRpcPhaseCount; ++phase)
+        {
+          into.phaseSumNanos[phase] += from.phaseSumNanos[phase];
+          into.phaseMaxNanos[phase] = std::max(into.phaseMaxNanos[phase], from.phaseMaxNanos[phase]);
+        }
+      }
+      merged.bytesSent += snapshot.bytesSent;
+      merged.bytesReceived += snapshot.bytesReceived;
+      for (size_t type = 0; type < WfsMetricsSnapshot::kTransportErrorTypes; ++type)
+      {
+        merged.transportErrors[type] += snapshot.transportErrors[type];
+      }
+      merged.inFlight += snapshot.inFlight;
+      merged.openConnections += snapshot.openConnections;
+      merged.reconnects += snapshot.reconnects;
+      merged.listingCacheHits += snapshot.listingCacheHits;
+      merged.listingCacheMisses += snapshot.listingCacheMisses;
+      merged.coalescedReads += snapshot.coalescedReads;
+      merged.slowRequestsDropped += snapshot.slowRequestsDropped;
+
+      if (BreakerSeverity(snapshot.breakerState) > BreakerSeverity(merged.breakerState))
+      {
+        merged.breakerState = snapshot.breakerState;
+      }
+      for (size_t state = 0; state < kWfsBreakerStateCount; ++state)
+      {
+        merged.breakerTransitions[state] += snapshot.breakerTransitions[state];
+      }
+      merged.breakerRejected += snapshot.breakerRejected;
+
+      merged.healthPings += snapshot.healthPings;
+      merged.healthReconnects += snapshot.healthReconnects;
+      merged.hedgedReads += snapshot.hedgedReads;
+      merged.hedgeWins += snapshot.hedgeWins;
+      if (snapshot.connectionRttMicros > 0)
+      {
+        rttSum += snapshot.connectionRttMicros;
+        ++rttCount;
+      }
+    }
+    merged.connectionRttMicros = rttCount > 0 ? rttSum / rttCount : 0;
+    return merged;
+  }
+
+} // namespace wfs_client
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <thrift/protocol/TProtocolDecorator.h>
+#include <thrift/transport/TTransportException.h>
+#include <thrift/transport/TVirtualTransport.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "wfs_client/datatype_.hpp"
+
+namespace wfs_client
+{
+
+  // Pass-through transport imposing simulated WAN conditions on a real
+  // connection (WfsConnectionParams::networkSimulation):
+  //  - connect costs one RTT;
+  //  - writes and reads are paced to the bandwidth limit (per direction);
+  //  - each flushed request makes its reply readable no earlier than
+  //    RTT + jitter (+ stall) after the flush. Replies are matched to
+  //    requests in order, so pipelined requests overlap their round trips.
+  //    Reply boundaries come from NetworkSimProtocol: the first socket read
+  //    of a reply waits for its due time, or, when the buffered transport
+  //    already holds the whole reply, the end of the reply does.
+  // Jitter and stalls come from a generator seeded with simulation.seed,
+  // so a given call sequence sees the same delays on every run. A stall
+  // longer than the receive timeout surfaces as TIMED_OUT, as on a real link.
+  class NetworkSimTransport : public apache::thrift::transport::TVirtualTransport<NetworkSimTransport>
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    NetworkSimTransport(std::shared_ptr<apache::thrift::transport::TTransport> inner,
+                        const WfsNetworkSimulation &simulation, int receiveTimeoutMs)
+        : TVirtualTransport(inner->getConfiguration()), m_inner(std::move(inner)),
+          m_sim(simulation), m_receiveTimeout(std::chrono::milliseconds(receiveTimeoutMs)),
+          m_rng(simulation.seed)
+    {
+    }
+
+    bool isOpen() const override
+    {
+      return m_inner->isOpen();
+    }
+
+    bool peek() override
+    {
+      return m_inner->peek();
+    }
+
+    void open() override
+    {
+      m_inner->open();
+      std::this_thread::sleep_for(std::chrono::microseconds(m_sim.rttMicros));
+      m_sendFree = m_recvFree = Clock::now();
+      m_replyDue.clear();
+      m_awaitingReply = false;
+    }
+
+    void close() override
+    {
+      m_replyDue.clear();
+      m_awaitingReply = false;
+      m_inner->close();
+    }
+
+    // A reply starts being decoded: take the due time of its request
+    void BeginReply()
+    {
+      if (m_replyDue.empty())
+      {
+        m_awaitingReply = false;
+        return;
+      }
+      m_currentReplyDue = m_replyDue.front();
+      m_replyDue.pop_front();
+      m_awaitingReply = true;
+    }
+
+    // The reply has been decoded without reading the socket
+    void EndReply()
+    {
+      if (m_awaitingReply)
+      {
+        m_awaitingReply = false;
+        WaitForReply(m_currentReplyDue);
+      }
+    }
+
+    uint32_t read(uint8_t *buf, uint32_t len)
+    {
+      if (m_awaitingReply)
+      {
+        m_awaitingReply = false;
+        WaitForReply(m_currentReplyDue);
+      }
+      const uint32_t got = m_inner->read(buf, len);
+      Pace(m_recvFree, got);
+      return got;
+    }
+
+    void write(const uint8_t *buf, uint32_t len)
+    {
+      m_inner->write(buf, len);
+      Pace(m_sendFree, len);
+    }
+
+    void flush() override
+    {
+      m_inner->flush();
+      auto delay = std::chrono::microseconds(m_sim.rttMicros);
+      if (m_sim.jitterMicros > 0)
+      {
+        delay += std::chrono::microseconds(static_cast<int64_t>(Next() % static_cast<uint64_t>(m_sim.jitterMicros + 1)));
+      }
+      if (m_sim.stallProbability > 0 && NextUnit() < m_sim.stallProbability)
+      {
+        delay += std::chrono::microseconds(m_sim.stallMicros);
+      }
+      m_replyDue.push_back(Clock::now() + delay);
+    }
+
+    uint32_t readEnd() override
+    {
+      return m_inner->readEnd();
+    }
+
+    uint32_t writeEnd() override
+    {
+      return m_inner->writeEnd();
+    }
+
+    const std::string getOrigin() const override
+    {
+      return m_inner->getOrigin();
+    }
+
+  private:
+    void WaitForReply(Clock::time_point due)
+    {
+      const Clock::time_point now = Clock::now();
+      if (due <= now)
+      {
+        return;
+      }
+      if (m_receiveTimeout.count() > 0 && due - now > m_receiveTimeout)
+      {
+        std::this_thread::sleep_for(m_receiveTimeout);
+        throw apache::thrift::transport::TTransportException(
+            apache::thrift::transport::TTransportException::TIMED_OUT,
+            "Simulated network stall exceeded the receive timeout");
+      }
+      std::this_thread::sleep_until(due);
+    }
+
+    // Serialize bytes onto a link of the configured bandwidth; linkFree is
+    // when that direction finishes what it was already given
+    void Pace(Clock::time_point &linkFree, uint32_t bytes)
+    {
+      if (m_sim.bandwidthBytesPerSecond <= 0 || bytes == 0)
+      {
+        return;
+      }
+      const auto transfer = std::chrono::nanoseconds(
+          static_cast<int64_t>(bytes) * 1000000000 / m_sim.bandwidthBytesPerSecond);
+      const Clock::time_point now = Clock::now();
+      linkFree = (linkFree > now ? linkFree : now) + transfer;
+      std::this_thread::sleep_until(linkFree);
+    }
+
+    // splitmix64
+    uint64_t Next()
+    {
+      uint64_t z = (m_rng += 0x9e3779b97f4a7c15ull);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      return z ^ (z >> 31);
+    }
+
+    double NextUnit()
+    {
+      return static_cast<double>(Next() >> 11) * 0x1.0p-53;
+    }
+
+    std::shared_ptr<apache::thrift::transport::TTransport> m_inner;
+    WfsNetworkSimulation m_sim;
+    std::chrono::milliseconds m_receiveTimeout;
+    uint64_t m_rng;
+    Clock::time_point m_sendFree{};
+    Clock::time_point m_recvFree{};
+    std::deque<Clock::time_point> m_replyDue; // per flushed request not answered yet
+    Clock::time_point m_currentReplyDue;
+    bool m_awaitingReply{false}; // reply begun, its due time not waited for yet
+  };
+
+  // Protocol decorator telling a NetworkSimTransport where replies start
+  // and end, so each reply consumes exactly one request's due time however
+  // the buffered transport splits or merges them into socket reads
+  class NetworkSimProtocol : public apache::thrift::protocol::TProtocolDecorator
+  {
+  public:
+    NetworkSimProtocol(std::shared_ptr<apache::thrift::protocol::TProtocol> protocol,
+                       std::shared_ptr<NetworkSimTransport> link)
+        : TProtocolDecorator(std::move(protocol)), m_link(std::move(link))
+    {
+    }
+
+    uint32_t readMessageBegin_virt(std::string &name, apache::thrift::protocol::TMessageType &messageType,
+                                   int32_t &seqid) override
+    {
+      m_link->BeginReply();
+      return TProtocolDecorator::readMessageBegin_virt(name, messageType, seqid);
+    }
+
+    uint32_t readMessageEnd_virt() override
+    {
+      const uint32_t size = TProtocolDecorator::readMessageEnd_virt();
+      m_link->EndReply();
+      return size;
+    }
+
+  private:
+    std::shared_ptr<NetworkSimTransport> m_link;
+  };
+
+} // namespace wfs_client
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <thrift/transport/TVirtualTransport.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "tsc_clock.hpp"
+
+namespace wfs_client
+{
+
+  // Pass-through transport placed between the buffered transport and the
+  // socket. It accumulates the TscClock ticks spent inside socket writes and
+  // reads, which lets a caller split an RPC into serialization/send/wait/
+  // decode. Used by one connection at a time (under the client lock), so the
+  // counters are plain fields.
+  class PhaseTransport : public apache::thrift::transport::TVirtualTransport<PhaseTransport>
+  {
+  public:
+    explicit PhaseTransport(std::shared_ptr<apache::thrift::transport::TTransport> inner)
+        : TVirtualTransport(inner->getConfiguration()), m_inner(std::move(inner))
+    {
+    }
+
+    bool isOpen() const override
+    {
+      return m_inner->isOpen();
+    }
+
+    bool peek() override
+    {
+      return m_inner->peek();
+    }
+
+    void open() override
+    {
+      m_inner->open();
+    }
+
+    void close() override
+    {
+      m_inner->close();
+    }
+
+    uint32_t read(uint8_t *buf, uint32_t len)
+    {
+      const uint64_t start = TscClock::Now();
+      const uint32_t got = m_inner->read(buf, len);
+      m_readTicks += TscClock::Elapsed(start, TscClock::Now());
+      return got;
+    }
+
+    void write(const uint8_t *buf, uint32_t len)
+    {
+      const uint64_t start = TscClock::Now();
+      m_inner->write(buf, len);
+      m_writeTicks += TscClock::Elapsed(start, TscClock::Now());
+    }
+
+    void flush() override
+    {
+      const uint64_t start = TscClock::Now();
+      m_inner->flush();
+      m_writeTicks += TscClock::Elapsed(start, TscClock::Now());
+    }
+
+    uint32_t readEnd() override
+    {
+      return m_inner->readEnd();
+    }
+
+    uint32_t writeEnd() override
+    {
+      return m_inner->writeEnd();
+    }
+
+    const std::string getOrigin() const override
+    {
+      return m_inner->getOrigin();
+    }
+
+    void ResetTicks()
+    {
+      m_readTicks = 0;
+      m_writeTicks = 0;
+    }
+
+    // Ticks spent in socket reads (waiting for and receiving replies)
+    uint64_t ReadTicks() const
+    {
+      return m_readTicks;
+    }
+
+    // Ticks spent in socket writes
+    uint64_t WriteTicks() const
+    {
+      return m_writeTicks;
+    }
+
+  private:
+    std::shared_ptr<apache::thrift::transport::TTransport> m_inner;
+    uint64_t m_readTicks{0};
+    uint64_t m_writeTicks{0};
+  };
+
+} // namespace wfs_client
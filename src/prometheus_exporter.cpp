@@ -0,0 +1,463 @@
+#include <thrift/transport/TServerSocket.h>
+#include <thrift/transport/TTransportException.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include "wfs_client/prometheus_exporter.hpp"
+#include "wfs_log.hpp"
+
+using namespace apache::thrift::transport;
+
+namespace wfs_client
+{
+
+  namespace
+  {
+
+    // TTransportException::TTransportExceptionType values as label values
+    const char *const kTransportErrorNames[WfsMetricsSnapshot::kTransportErrorTypes] = {
+        "unknown", "not_open", "timed_out", "end_of_file", "interrupted",
+        "bad_args", "corrupted_data", "internal_error", "client_disconnect"};
+
+    const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+    // Largest HTTP request header accepted by the endpoint
+    constexpr size_t kMaxRequestBytes = 8192;
+
+    std::string EscapeLabelValue(std::string_view value)
+    {
+      std::string escaped;
+      escaped.reserve(value.size());
+      for (char c : value)
+      {
+        switch (c)
+        {
+        case '\\':
+          escaped += "\\\\";
+          break;
+        case '"':
+          escaped += "\\\"";
+          break;
+        case '\n':
+          escaped += "\\n";
+          break;
+        default:
+          escaped += c;
+          break;
+        }
+      }
+      return escaped;
+    }
+
+    // Writes metric families in text exposition format
+    class PrometheusWriter
+    {
+    public:
+      PrometheusWriter(fmt::memory_buffer &out, const std::string &clientLabel)
+          : m_out(out)
+      {
+        if (!clientLabel.empty())
+        {
+          m_clientLabel = "client=\"" + EscapeLabelValue(clientLabel) + "\"";
+        }
+      }
+
+      void Family(std::string_view name, std::string_view type, std::string_view help)
+      {
+        fmt::format_to(fmt::appender(m_out), "# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+      }
+
+      // labels is a preformatted list such as op="get" (may be empty)
+      template <typename T>
+      void Sample(std::string_view name, std::string_view labels, T value)
+      {
+        fmt::format_to(fmt::appender(m_out), "{}", name);
+        if (!m_clientLabel.empty() || !labels.empty())
+        {
+          fmt::format_to(fmt::appender(m_out), "{{{}{}{}}}", m_clientLabel,
+                         !m_clientLabel.empty() && !labels.empty() ? "," : "", labels);
+        }
+        fmt::format_to(fmt::appender(m_out), " {}\n", value);
+      }
+
+    private:
+      fmt::memory_buffer &m_out;
+      std::string m_clientLabel;
+    };
+
+    class PrometheusExporter : public IWfsPrometheusExporter
+    {
+    public:
+      PrometheusExporter(const std::shared_ptr<IWfsClient> &client,
+                         const WfsPrometheusExporterOptions &options)
+          : m_client(client), m_options(options)
+      {
+      }
+
+      ~PrometheusExporter() override
+      {
+        Stop();
+      }
+
+      bool Start()
+      {
+        if (m_options.listenPort > 0)
+        {
+          try
+          {
+            m_server = std::make_shared<TServerSocket>(m_options.listenAddress, m_options.listenPort);
+            m_server->setRecvTimeout(5000);
+            m_server->setSendTimeout(5000);
+            m_server->listen();
+          }
+          catch (const TTransportException &e)
+          {
+            WFS_LOG_ERROR("Metrics endpoint {}:{} failed to listen: {}",
+                          m_options.listenAddress, m_options.listenPort, e.what());
+            m_server.reset();
+            return false;
+          }
+          m_serveThread = std::thread([this]()
+                                      { ServeLoop(); });
+          WFS_LOG_INFO("Serving metrics on http://{}:{}/metrics",
+                       m_options.listenAddress, m_options.listenPort);
+        }
+
+        if (!m_options.filePath.empty())
+        {
+          m_fileThread = std::thread([this]()
+                                     { FileLoop(); });
+        }
+        return true;
+      }
+
+      void Stop() override
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (m_stopping)
+          {
+            return;
+          }
+          m_stopping = true;
+        }
+        m_cv.notify_all();
+
+        if (m_server)
+        {
+          m_server->interrupt();
+        }
+        if (m_serveThread.joinable())
+        {
+          m_serveThread.join();
+        }
+        if (m_server)
+        {
+          m_server->close();
+        }
+        if (m_fileThread.joinable())
+        {
+          m_fileThread.join();
+        }
+      }
+
+    private:
+      std::string Render()
+      {
+        std::string text;
+        if (auto client = m_client.lock())
+        {
+          RenderWfsPrometheusMetrics(client->GetMetrics(), m_options.clientLabel, text);
+        }
+        return text;
+      }
+
+      // Write to a temporary file and rename it, so scrapers never read a
+      // partially written file
+      void WriteFile()
+      {
+        const std::string tempPath = m_options.filePath + ".tmp";
+        {
+          std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+          if (!out)
+          {
+            WFS_LOG_WARN("Cannot write metrics file: {}", tempPath);
+            return;
+          }
+          out << Render();
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempPath, m_options.filePath, ec);
+        if (ec)
+        {
+          WFS_LOG_WARN("Cannot replace metrics file {}: {}", m_options.filePath, ec.message());
+        }
+      }
+
+      void FileLoop()
+      {
+        const auto interval = std::chrono::milliseconds(std::max(100, m_options.fileInterval));
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopping)
+        {
+          lock.unlock();
+          WriteFile();
+          lock.lock();
+          m_cv.wait_for(lock, interval, [this]()
+                        { return m_stopping; });
+        }
+      }
+
+      bool Stopping()
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stopping;
+      }
+
+      void ServeLoop()
+      {
+        while (!Stopping())
+        {
+          std::shared_ptr<TTransport> connection;
+          try
+          {
+            connection = m_server->accept();
+          }
+          catch (const TTransportException &e)
+          {
+            if (!Stopping())
+            {
+              WFS_LOG_WARN("Metrics endpoint accept failed: {}", e.what());
+              std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            continue;
+          }
+          if (!connection)
+          {
+            continue;
+          }
+
+          try
+          {
+            HandleRequest(*connection);
+          }
+          catch (const TTransportException &e)
+          {
+            WFS_LOG_DEBUG("Metrics request failed: {}", e.what());
+          }
+
+          try
+          {
+            connection->close();
+          }
+          catch (...)
+          {
+            // Ignore exceptions during disconnection
+          }
+        }
+      }
+
+      // Minimal HTTP/1.0 handling: one request per connection
+      void HandleRequest(TTransport &connection)
+      {
+        std::string request;
+        uint8_t buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestBytes)
+        {
+          const uint32_t got = connection.read(buffer, sizeof(buffer));
+          if (got == 0)
+          {
+            break;
+          }
+          request.append(reinterpret_cast<const char *>(buffer), got);
+        }
+
+        const std::string_view line(request.data(), std::min(request.find("\r\n"), request.size()));
+        std::string status = "200 OK";
+        std::string body;
+        if (line.rfind("GET /metrics ", 0) == 0 || line.rfind("GET / ", 0) == 0)
+        {
+          body = Render();
+        }
+        else
+        {
+          status = "404 Not Found";
+          body = "Not found, metrics are served at /metrics\n";
+        }
+
+        const std::string response = fmt::format(
+            "HTTP/1.0 {}\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+            "Content-Length: {}\r\nConnection: close\r\n\r\n{}",
+            status, body.size(), body);
+        connection.write(reinterpret_cast<const uint8_t *>(response.data()),
+                         static_cast<uint32_t>(response.size()));
+        connection.flush();
+      }
+
+      std::weak_ptr<IWfsClient> m_client;
+      WfsPrometheusExporterOptions m_options;
+
+      std::mutex m_mutex;
+      std::condition_variable m_cv;
+      bool m_stopping{false};
+      std::shared_ptr<TServerSocket> m_server;
+      std::thread m_serveThread;
+      std::thread m_fileThread;
+    };
+
+  } // namespace
+
+  void RenderWfsPrometheusMetrics(const WfsMetricsSnapshot &metrics,
+                                  const std::string &clientLabel,
+                                  std::string &outText)
+  {
+    fmt::memory_buffer out;
+    PrometheusWriter writer(out, clientLabel);
+
+    writer.Family("wfs_client_requests_total", "counter", "RPCs issued, by operation");
+    for (size_t op = 0; op < kWfsOpTypeCount; ++op)
+    {
+      writer.Sample("wfs_client_requests_total",
+                    fmt::format("op=\"{}\"", WfsOpTypeName(static_cast<WfsOpType>(op))),
+                    metrics.ops[op].calls);
+    }
+
+    writer.Family("wfs_client_request_errors_total", "counter", "RPCs that failed, by operation");
+    for (size_t op = 0; op < kWfsOpTypeCount; ++op)
+    {
+      writer.Sample("wfs_client_request_errors_total",
+                    fmt::format("op=\"{}\"", WfsOpTypeName(static_cast<WfsOpType>(op))),
+                    metrics.ops[op].errors);
+    }
+
+    writer.Family("wfs_client_request_duration_seconds", "summary", "RPC latency, by operation");
+    for (size_t op = 0; op < kWfsOpTypeCount; ++op)
+    {
+      const WfsLatencyHistogram &latency = metrics.ops[op].latency;
+      const char *name = WfsOpTypeName(static_cast<WfsOpType>(op));
+      for (double quantile : kQuantiles)
+      {
+        writer.Sample("wfs_client_request_duration_seconds",
+                      fmt::format("op=\"{}\",quantile=\"{}\"", name, quantile),
+                      static_cast<double>(latency.Percentile(quantile)) / 1e6);
+      }
+      writer.Sample("wfs_client_request_duration_seconds_sum", fmt::format("op=\"{}\"", name),
+                    static_cast<double>(latency.sumMicros) / 1e6);
+      writer.Sample("wfs_client_request_duration_seconds_count", fmt::format("op=\"{}\"", name),
+                    latency.count);
+    }
+
+    writer.Family("wfs_client_request_phase_seconds_total", "counter",
+                  "Time spent per round-trip phase (serialize, send, wait, deserialize), by operation");
+    for (size_t op = 0; op < kWfsOpTypeCount; ++op)
+    {
+      for (size_t phase = 0; phase < kWfsRpcPhaseCount; ++phase)
+      {
+        writer.Sample("wfs_client_request_phase_seconds_total",
+                      fmt::format("op=\"{}\",phase=\"{}\"", WfsOpTypeName(static_cast<WfsOpType>(op)),
+                                  WfsRpcPhaseName(static_cast<WfsRpcPhase>(phase))),
+                      static_cast<double>(metrics.ops[op].phaseSumNanos[phase]) / 1e9);
+      }
+    }
+
+    writer.Family("wfs_client_in_flight_requests", "gauge", "RPCs waiting for their reply");
+    writer.Sample("wfs_client_in_flight_requests", "", metrics.inFlight);
+
+    writer.Family("wfs_client_open_connections", "gauge", "Server connections currently open");
+    writer.Sample("wfs_client_open_connections", "", metrics.openConnections);
+
+    writer.Family("wfs_client_reconnects_total", "counter", "Successful reconnections to the server");
+    writer.Sample("wfs_client_reconnects_total", "", metrics.reconnects);
+
+    writer.Family("wfs_client_sent_bytes_total", "counter", "File payload bytes uploaded");
+    writer.Sample("wfs_client_sent_bytes_total", "", metrics.bytesSent);
+
+    writer.Family("wfs_client_received_bytes_total", "counter", "File payload bytes downloaded");
+    writer.Sample("wfs_client_received_bytes_total", "", metrics.bytesReceived);
+
+    writer.Family("wfs_client_transport_errors_total", "counter", "Transport exceptions, by type");
+    for (size_t type = 0; type < WfsMetricsSnapshot::kTransportErrorTypes; ++type)
+    {
+      writer.Sample("wfs_client_transport_errors_total",
+                    fmt::format("type=\"{}\"", kTransportErrorNames[type]),
+                    metrics.transportErrors[type]);
+    }
+
+    const uint64_t lookups = metrics.listingCacheHits + metrics.listingCacheMisses;
+    writer.Family("wfs_client_listing_cache_lookups_total", "counter", "Stat/Exists lookups in cached directory listings");
+    writer.Sample("wfs_client_listing_cache_lookups_total", "result=\"hit\"", metrics.listingCacheHits);
+    writer.Sample("wfs_client_listing_cache_lookups_total", "result=\"miss\"", metrics.listingCacheMisses);
+
+    writer.Family("wfs_client_listing_cache_hit_ratio", "gauge", "Share of Stat/Exists lookups answered without a List RPC");
+    writer.Sample("wfs_client_listing_cache_hit_ratio", "",
+                  lookups == 0 ? 0.0 : static_cast<double>(metrics.listingCacheHits) / static_cast<double>(lookups));
+
+    writer.Family("wfs_client_coalesced_reads_total", "counter", "Get/List calls that joined an identical request in flight");
+    writer.Sample("wfs_client_coalesced_reads_total", "", metrics.coalescedReads);
+
+    writer.Family("wfs_client_circuit_breaker_state", "gauge", "Circuit breaker state (0 closed, 1 open, 2 half-open)");
+    writer.Sample("wfs_client_circuit_breaker_state", "", static_cast<int64_t>(metrics.breakerState));
+
+    writer.Family("wfs_client_circuit_breaker_transitions_total", "counter", "Circuit breaker state changes, by new state");
+    for (size_t state = 0; state < kWfsBreakerStateCount; ++state)
+    {
+      writer.Sample("wfs_client_circuit_breaker_transitions_total",
+                    fmt::format("state=\"{}\"", WfsBreakerStateName(static_cast<WfsBreakerState>(state))),
+                    metrics.breakerTransitions[state]);
+    }
+
+    writer.Family("wfs_client_circuit_breaker_rejected_total", "counter", "Calls failed fast by the open circuit breaker");
+    writer.Sample("wfs_client_circuit_breaker_rejected_total", "", metrics.breakerRejected);
+
+    writer.Family("wfs_client_health_pings_total", "counter", "Keepalive Pings sent on idle connections");
+    writer.Sample("wfs_client_health_pings_total", "", metrics.healthPings);
+
+    writer.Family("wfs_client_health_reconnects_total", "counter", "Dead connections reopened by the health checker");
+    writer.Sample("wfs_client_health_reconnects_total", "", metrics.healthReconnects);
+
+    writer.Family("wfs_client_connection_rtt_seconds", "gauge", "Smoothed Ping round trip of the connection");
+    writer.Sample("wfs_client_connection_rtt_seconds", "", static_cast<double>(metrics.connectionRttMicros) / 1e6);
+
+    writer.Family("wfs_client_hedged_reads_total", "counter", "Downloads also sent to a second replica");
+    writer.Sample("wfs_client_hedged_reads_total", "", metrics.hedgedReads);
+
+    writer.Family("wfs_client_hedge_wins_total", "counter", "Hedged downloads answered by the second replica first");
+    writer.Sample("wfs_client_hedge_wins_total", "", metrics.hedgeWins);
+
+    outText.assign(out.data(), out.size());
+  }
+
+  bool CreateWfsPrometheusExporter(std::shared_ptr<IWfsPrometheusExporter> &exporter,
+                                   const std::shared_ptr<IWfsClient> &client,
+                                   const WfsPrometheusExporterOptions &options)
+  {
+    if (!client)
+    {
+      WFS_LOG_ERROR("Metrics exporter creation failed: no client");
+      return false;
+    }
+    if (options.filePath.empty() && options.listenPort <= 0)
+    {
+      WFS_LOG_ERROR("Metrics exporter creation failed: neither filePath nor listenPort is set");
+      return false;
+    }
+
+    auto created = std::make_shared<PrometheusExporter>(client, options);
+    if (!created->Start())
+    {
+      return false;
+    }
+    exporter = std::move(created);
+    return true;
+  }
+
+} // namespace wfs_client
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#include "wfs_client/datatype_.hpp"
+
+namespace wfs_client
+{
+
+  // Waits between the attempts of one operation: exponential backoff with
+  // full jitter (uniform in [0, min(maxBackoff, initialBackoff * multiplier^n)]),
+  // bounded by the attempt count and the policy's maxElapsed since the
+  // first attempt
+  class RetryBackoff
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    RetryBackoff(const WfsRetryPolicy &policy, int maxAttempts)
+        : m_policy(policy), m_maxAttempts(std::max(1, maxAttempts)), m_start(Clock::now()),
+          m_rng(static_cast<uint64_t>(m_start.time_since_epoch().count()) ^ reinterpret_cast<uintptr_t>(this))
+    {
+    }
+
+    // Wait before the next attempt, or nullopt when attempts or time ran out
+    std::optional<std::chrono::milliseconds> Next()
+    {
+      if (++m_attempt >= m_maxAttempts)
+      {
+        return std::nullopt;
+      }
+
+      double ceiling = static_cast<double>(std::max(0, m_policy.initialBackoff));
+      for (int i = 1; i < m_attempt && ceiling < m_policy.maxBackoff; ++i)
+      {
+        ceiling *= m_policy.multiplier;
+      }
+      ceiling = std::min(ceiling, static_cast<double>(std::max(0, m_policy.maxBackoff)));
+      const auto wait = std::chrono::milliseconds(static_cast<int64_t>(ceiling * NextUnit()));
+
+      if (m_policy.maxElapsed > 0 &&
+          Clock::now() + wait - m_start > std::chrono::milliseconds(m_policy.maxElapsed))
+      {
+        return std::nullopt;
+      }
+      return wait;
+    }
+
+    // Attempts made before the current one
+    int Retries() const
+    {
+      return m_attempt;
+    }
+
+    int MaxAttempts() const
+    {
+      return m_maxAttempts;
+    }
+
+  private:
+    // splitmix64 mapped to [0, 1]
+    double NextUnit()
+    {
+      uint64_t z = (m_rng += 0x9e3779b97f4a7c15ull);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      z ^= z >> 31;
+      return static_cast<double>(z >> 11) * 0x1.0p-53;
+    }
+
+    const WfsRetryPolicy &m_policy;
+    int m_maxAttempts;
+    int m_attempt{0};
+    Clock::time_point m_start;
+    uint64_t m_rng;
+  };
+
+} // namespace wfs_client
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <string_view>
+
+#include "phase_transport.hpp"
+#include "slow_request_log.hpp"
+#include "tsc_clock.hpp"
+#include "wfs_probes.hpp"
+#include "wfs_metrics.hpp"
+#include "wfs_tracing.hpp"
+
+namespace wfs_client
+{
+
+  inline const char *SpanName(WfsOpType op)
+  {
+    switch (op)
+    {
+    case WfsOpType::Connect:
+      return "wfs.connect";
+    case WfsOpType::Auth:
+      return "wfs.auth";
+    case WfsOpType::Append:
+      return "wfs.upload";
+    case WfsOpType::Get:
+      return "wfs.download";
+    case WfsOpType::Delete:
+      return "wfs.delete";
+    case WfsOpType::Rename:
+      return "wfs.rename";
+    case WfsOpType::List:
+      return "wfs.list";
+    case WfsOpType::Ping:
+      return "wfs.ping";
+    default:
+      return "wfs.unknown";
+    }
+  }
+
+  // Instrumentation of one RPC: latency and phase metrics, a trace span and
+  // a slow request record, emitted when leaving scope. Counted as an error
+  // unless Succeeded() was called. Timing uses TscClock ticks.
+  class RpcScope
+  {
+  public:
+    // path must outlive the scope; requestBytes is the payload sent, if any
+    RpcScope(WfsMetricsRecorder &metrics, SlowRequestLog &slowLog, WfsOpType op,
+             std::string_view path = {}, uint64_t connectionId = 0, uint64_t requestBytes = 0)
+        : m_metrics(metrics), m_slowLog(slowLog), m_op(op), m_path(path),
+          m_connectionId(connectionId), m_span(SpanName(op), path), m_start(TscClock::Now()),
+          m_bytes(requestBytes)
+    {
+      m_metrics.AddInFlight(1);
+      m_span.SetBytes(requestBytes);
+      WFS_PROBE3(request__start, static_cast<int>(m_op), m_path.size(), m_bytes);
+    }
+
+    ~RpcScope()
+    {
+      const uint64_t elapsedNanos = TscClock::ToNanos(TscClock::Elapsed(m_start, TscClock::Now()));
+      m_metrics.RecordOp(m_op, elapsedNanos, m_ok);
+      m_metrics.AddInFlight(-1);
+      m_span.SetOk(m_ok);
+      WFS_PROBE5(request__done, static_cast<int>(m_op), m_path.size(), m_bytes, elapsedNanos, m_ok);
+      if (m_slowLog.IsSlow(m_op, elapsedNanos))
+      {
+        LogSlow(elapsedNanos);
+      }
+    }
+
+    RpcScope(const RpcScope &) = delete;
+    RpcScope &operator=(const RpcScope &) = delete;
+
+    void Succeeded()
+    {
+      m_ok = true;
+    }
+
+    void SetBytes(uint64_t bytes)
+    {
+      m_bytes = bytes;
+      m_span.SetBytes(bytes);
+    }
+
+    void SetRetries(int retries)
+    {
+      m_retries = retries;
+    }
+
+    // Issue the request (send) and read its reply (recv). Socket time
+    // measured by phases splits the call into serialize/send/wait/deserialize;
+    // buffered writes interleave serialization and sending, so the phases are
+    // accumulated durations (and laid out back to back as trace sub-spans).
+    template <typename Send, typename Recv>
+    void Call(PhaseTransport *phases, Send &&send, Recv &&recv)
+    {
+      if (!phases)
+      {
+        send();
+        recv();
+        return;
+      }
+
+      phases->ResetTicks();
+      const auto spanStart = m_span.Active() ? TraceSpan::Clock::now() : TraceSpan::Clock::time_point();
+      const uint64_t sendStart = TscClock::Now();
+      send();
+      const uint64_t recvStart = TscClock::Now();
+      recv();
+      const uint64_t recvEnd = TscClock::Now();
+
+      const uint64_t sendTotal = TscClock::Elapsed(sendStart, recvStart);
+      const uint64_t recvTotal = TscClock::Elapsed(recvStart, recvEnd);
+      const uint64_t write = std::min(phases->WriteTicks(), sendTotal);
+      const uint64_t read = std::min(phases->ReadTicks(), recvTotal);
+
+      uint64_t(&phaseNanos)[kWfsRpcPhaseCount] = m_phaseNanos;
+      phaseNanos[static_cast<size_t>(WfsRpcPhase::Serialize)] = TscClock::ToNanos(sendTotal - write);
+      phaseNanos[static_cast<size_t>(WfsRpcPhase::Send)] = TscClock::ToNanos(write);
+      phaseNanos[static_cast<size_t>(WfsRpcPhase::Wait)] = TscClock::ToNanos(read);
+      phaseNanos[static_cast<size_t>(WfsRpcPhase::Deserialize)] = TscClock::ToNanos(recvTotal - read);
+      m_metrics.RecordPhases(m_op, phaseNanos);
+
+      if (m_span.Active())
+      {
+        auto start = spanStart;
+        for (size_t phase = 0; phase < kWfsRpcPhaseCount; ++phase)
+        {
+          const auto duration = std::chrono::duration_cast<TraceSpan::Clock::duration>(
+              std::chrono::nanoseconds(phaseNanos[phase]));
+          m_span.AddChild(WfsRpcPhaseName(static_cast<WfsRpcPhase>(phase)), start, duration);
+          start += duration;
+        }
+      }
+    }
+
+  private:
+    void LogSlow(uint64_t elapsedNanos) const
+    {
+      WfsSlowRequest record;
+      record.op = m_op;
+      record.path.assign(m_path.data(), m_path.size());
+      record.bytes = m_bytes;
+      record.timestampMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count();
+      record.durationMicros = elapsedNanos / 1000;
+      for (size_t phase = 0; phase < kWfsRpcPhaseCount; ++phase)
+      {
+        record.phaseMicros[phase] = m_phaseNanos[phase] / 1000;
+      }
+      record.connectionId = m_connectionId;
+      record.retries = m_retries;
+      record.ok = m_ok;
+      m_slowLog.Push(record);
+    }
+
+    WfsMetricsRecorder &m_metrics;
+    SlowRequestLog &m_slowLog;
+    WfsOpType m_op;
+    std::string_view m_path;
+    uint64_t m_connectionId;
+    TraceSpan m_span;
+    uint64_t m_start;
+    uint64_t m_bytes{0};
+    uint64_t m_phaseNanos[kWfsRpcPhaseCount]{};
+    int m_retries{0};
+    bool m_ok{false};
+  };
+
+} // namespace wfs_client
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "wfs_client/datatype_.hpp"
+
+namespace wfs_client
+{
+
+  // Reply wait estimator of one client's connections, in the spirit of TCP's
+  // retransmission timer (RFC 6298). A sample is the time from a request's
+  // flush to the first byte of its reply, modelled as
+  //
+  //   wait = rtt + requestBytes * costPerByte
+  //
+  // Small requests smooth rtt (srtt/rttvar); large ones smooth costPerByte
+  // (the inverse of the throughput the server absorbs an upload at). The
+  // timeout for a request is
+  //
+  //   slack * (srtt + requestBytes * costPerByte) + 4 * rttvar
+  //
+  // where slack is the 99th percentile of recent actual/predicted ratios,
+  // clamped to [minTimeout, maxTimeout]. Each timeout doubles the next one
+  // until a reply arrives again. Used under the client lock only.
+  class RttEstimator
+  {
+  public:
+    using Duration = std::chrono::duration<double, std::milli>;
+
+    // Requests up to this size count as rtt samples
+    static constexpr uint64_t kSmallRequestBytes = 16 * 1024;
+
+    RttEstimator(const WfsAdaptiveTimeout &config, int maxTimeoutMs)
+        : m_minTimeout(std::max(1, config.minTimeout)),
+          m_maxTimeout(maxTimeoutMs > 0 ? maxTimeoutMs : 0),
+          m_warmupSamples(std::max(1, config.warmupSamples))
+    {
+    }
+
+    // Wait allowed for the reply to a request of requestBytes; zero while
+    // warming up (the static receive timeout applies)
+    std::chrono::milliseconds Timeout(uint64_t requestBytes) const
+    {
+      if (m_samples < m_warmupSamples)
+      {
+        return std::chrono::milliseconds::zero();
+      }
+      double timeout = Slack() * Predict(requestBytes) + 4 * m_rttvar;
+      timeout = std::max(timeout, m_minTimeout) * m_backoff;
+      if (m_maxTimeout > 0)
+      {
+        timeout = std::min(timeout, m_maxTimeout);
+      }
+      return std::chrono::milliseconds(static_cast<int64_t>(std::ceil(timeout)));
+    }
+
+    // First reply byte arrived wait after the request was flushed
+    void AddSample(Duration wait, uint64_t requestBytes)
+    {
+      const double measured = wait.count();
+      m_backoff = 1;
+
+      if (m_samples == 0)
+      {
+        m_srtt = measured;
+        m_rttvar = measured / 2;
+      }
+      else if (requestBytes <= kSmallRequestBytes)
+      {
+        m_rttvar = 0.75 * m_rttvar + 0.25 * std::abs(m_srtt - measured);
+        m_srtt = 0.875 * m_srtt + 0.125 * measured;
+      }
+      else if (measured > m_srtt)
+      {
+        const double cost = (measured - m_srtt) / static_cast<double>(requestBytes);
+        m_costPerByte = m_costPerByte > 0 ? 0.875 * m_costPerByte + 0.125 * cost : cost;
+      }
+
+      const double predicted = Predict(requestBytes);
+      if (predicted > 0)
+      {
+        m_ratios[m_next] = measured / predicted;
+        m_next = (m_next + 1) % m_ratios.size();
+        m_ratioCount = std::min(m_ratioCount + 1, m_ratios.size());
+      }
+      ++m_samples;
+    }
+
+    // A reply did not arrive in time: back off like TCP's timer
+    void OnTimeout()
+    {
+      m_backoff = std::min(m_backoff * 2, 64.0);
+    }
+
+    Duration SmoothedRtt() const
+    {
+      return Duration(m_srtt);
+    }
+
+  private:
+    double Predict(uint64_t requestBytes) const
+    {
+      return m_srtt + static_cast<double>(requestBytes) * m_costPerByte;
+    }
+
+    // 99th percentile of actual/predicted, at least 1
+    double Slack() const
+    {
+      if (m_ratioCount == 0)
+      {
+        return 1;
+      }
+      std::array<double, kRatioWindow> sorted;
+      std::copy_n(m_ratios.begin(), m_ratioCount, sorted.begin());
+      const size_t rank = std::min(m_ratioCount - 1, static_cast<size_t>(0.99 * static_cast<double>(m_ratioCount)));
+      std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.begin() + m_ratioCount);
+      return std::max(1.0, sorted[rank]);
+    }
+
+    static constexpr size_t kRatioWindow = 128;
+
+    const double m_minTimeout;
+    const double m_maxTimeout;
+    const int m_warmupSamples;
+
+    double m_srtt{0};        // milliseconds
+    double m_rttvar{0};      // milliseconds
+    double m_costPerByte{0}; // milliseconds per request byte
+    double m_backoff{1};
+    int m_samples{0};
+
+    std::array<double, kRatioWindow> m_ratios{};
+    size_t m_next{0};
+    size_t m_ratioCount{0};
+  };
+
+} // namespace wfs_client
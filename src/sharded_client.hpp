@@ -0,0 +1,635 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "wfs_client/sharding.hpp"
+#include "call_deadline.hpp"
+#include "hash_ring.hpp"
+#include "hedged_read.hpp"
+#include "multi_endpoint.hpp"
+#include "wfs_log.hpp"
+
+namespace wfs_client
+{
+
+  // IWfsShardedClient over one full client per node (connection, lock,
+  // retries, breaker, keepalive). The ring is an immutable snapshot swapped
+  // on every change, so calls never wait for a change in progress; a call
+  // keeps the node clients it started with alive until it returns.
+  class ShardedClient : public IWfsShardedClient
+  {
+  public:
+    using ClientFactory = std::function<std::shared_ptr<IWfsClient>()>;
+
+    explicit ShardedClient(ClientFactory factory)
+        : m_factory(std::move(factory))
+    {
+    }
+
+    // Connects every node; succeeds if any node does (the others keep
+    // reconnecting on their own)
+    WfsResult Connect(const WfsConnectionParams &params) override
+    {
+      std::lock_guard<std::mutex> change(m_changeMutex);
+      m_params = params;
+      m_replicas = static_cast<size_t>(std::max(1, params.sharding.replicas));
+      if (params.hedging.enabled && !m_hedger)
+      {
+        m_hedger = std::make_unique<HedgedReader>(params.hedging);
+      }
+      if (!Snapshot().first)
+      {
+        std::vector<Node> nodes;
+        for (const auto &address : params.sharding.nodes)
+        {
+          nodes.push_back({address, m_factory()});
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ring = std::make_shared<const Ring>(std::move(nodes), params.sharding.virtualNodes);
+      }
+      return ForAll([&](const Node &node)
+                    { return node.client->Connect(EndpointParams(m_params, node.address)); });
+    }
+
+    WfsResult Reconnect() override
+    {
+      return ForAll([](const Node &node)
+                    { return node.client->Reconnect(); });
+    }
+
+    void Disconnect() override
+    {
+      for (const Node &node : AllNodes())
+      {
+        node.client->Disconnect();
+      }
+    }
+
+    WfsResult Authenticate(const WfsAuthInfo &authInfo) override
+    {
+      {
+        std::lock_guard<std::mutex> change(m_changeMutex);
+        m_authInfo = authInfo;
+        m_hasAuthInfo = true;
+      }
+      return ForAll([&](const Node &node)
+                    { return node.client->Authenticate(authInfo); });
+    }
+
+    // To every replica; fails if any of them did
+    WfsResult UploadFile(const WfsFileData &fileData, const WfsCallOptions &options) override
+    {
+      const CallDeadline call(options);
+      WfsResult result = WfsResult::Success();
+      for (const Node &node : Owners(fileData.name, false))
+      {
+        WfsResult nodeResult = node.client->UploadFile(fileData, call.RemainingOptions());
+        if (!nodeResult && result)
+        {
+          result = nodeResult;
+        }
+      }
+      return Finish(result);
+    }
+
+    WfsResult DownloadFile(const std::string &remotePath, std::string &outData,
+                           const WfsCallOptions &options) override
+    {
+      std::shared_ptr<const std::string> sharedData;
+      WfsResult result = DownloadFileShared(remotePath, sharedData, options);
+      if (result && sharedData)
+      {
+        outData = *sharedData;
+      }
+      return result;
+    }
+
+    WfsResult DownloadFileShared(const std::string &remotePath,
+                                 std::shared_ptr<const std::string> &outData,
+                                 const WfsCallOptions &options) override
+    {
+      if (m_hedger)
+      {
+        std::vector<Node> owners = Owners(remotePath, true);
+        if (owners.size() > 1)
+        {
+          return HedgedDownload(remotePath, std::move(owners), outData, options);
+        }
+      }
+      return ReadFromOwners(remotePath, options, [&](IWfsClient &client, const WfsCallOptions &callOptions)
+                            { return client.DownloadFileShared(remotePath, outData, callOptions); });
+    }
+
+    // From every node that may hold a copy; succeeds if any copy was
+    // deleted. Copies on replicas that were down stay behind and may be
+    // read again once those replicas are back.
+    WfsResult DeleteFile(const std::string &remotePath, const WfsCallOptions &options) override
+    {
+      const CallDeadline call(options);
+      WfsResult result = WfsResult::Failure(-1, "No shard owns " + remotePath);
+      bool deleted = false;
+      for (const Node &node : Owners(remotePath, true))
+      {
+        WfsResult nodeResult = node.client->DeleteFile(remotePath, call.RemainingOptions());
+        if (nodeResult)
+        {
+          deleted = true;
+        }
+        else if (!deleted)
+        {
+          result = nodeResult;
+        }
+      }
+      return Finish(deleted ? WfsResult::Success() : result);
+    }
+
+    // Renamed in place when both paths have the same owners, otherwise
+    // copied to the new owners and deleted from the old ones (not atomic)
+    WfsResult RenameFile(const std::string &oldPath, const std::string &newPath,
+                         const WfsCallOptions &options) override
+    {
+      const CallDeadline call(options);
+      const auto rings = Snapshot();
+      const std::vector<Node> oldOwners = Owners(oldPath, false);
+      const std::vector<Node> newOwners = Owners(newPath, false);
+      if (!rings.second && SameClients(oldOwners, newOwners))
+      {
+        WfsResult result = WfsResult::Success();
+        for (const Node &node : oldOwners)
+        {
+          WfsResult nodeResult = node.client->RenameFile(oldPath, newPath, call.RemainingOptions());
+          if (!nodeResult && result)
+          {
+            result = nodeResult;
+          }
+        }
+        return Finish(result);
+      }
+
+      std::shared_ptr<const std::string> data;
+      WfsResult result = DownloadFileShared(oldPath, data, call.RemainingOptions());
+      if (!result)
+      {
+        return result;
+      }
+      result = UploadFile(WfsFileData(newPath, data ? *data : std::string()), call.RemainingOptions());
+      if (!result)
+      {
+        return result;
+      }
+      return DeleteFile(oldPath, call.RemainingOptions());
+    }
+
+    // Every node lists its part in parallel; the parts are merged by name
+    // (the newest copy wins). Complete as long as fewer nodes failed than
+    // there are replicas of each path (or nodes, with fewer nodes).
+    WfsResult ListDirectory(const std::string &remotePath, WfsDirList &outDirList,
+                            const WfsCallOptions &options) override
+    {
+      const std::vector<Node> nodes = AllNodes();
+      std::vector<std::future<std::pair<WfsResult, WfsDirList>>> parts;
+      for (const Node &node : nodes)
+      {
+        parts.push_back(std::async(std::launch::async, [&remotePath, &options, client = node.client]()
+                                   {
+                                     WfsDirList list;
+                                     WfsResult result = client->ListDirectory(remotePath, list, options);
+                                     return std::make_pair(std::move(result), std::move(list)); }));
+      }
+
+      std::vector<WfsDirItem> items;
+      WfsResult failure = WfsResult::Success();
+      size_t failed = 0;
+      for (auto &part : parts)
+      {
+        auto [result, list] = part.get();
+        if (!result)
+        {
+          ++failed;
+          failure = result;
+          continue;
+        }
+        for (auto &item : list.items)
+        {
+          items.push_back(std::move(item));
+        }
+      }
+      if (nodes.empty() || failed >= std::min(m_replicas, nodes.size()))
+      {
+        outDirList.error = failure.error;
+        return Finish(nodes.empty() ? WfsResult::Failure(-1, "No shards configured") : failure);
+      }
+
+      std::sort(items.begin(), items.end(), [](const WfsDirItem &a, const WfsDirItem &b)
+                { return a.name != b.name ? a.name < b.name : a.mtime > b.mtime; });
+      items.erase(std::unique(items.begin(), items.end(), [](const WfsDirItem &a, const WfsDirItem &b)
+                              { return a.name == b.name; }),
+                  items.end());
+      outDirList.path = remotePath;
+      outDirList.items = std::move(items);
+      outDirList.error = WfsErrorInfo();
+      return WfsResult::Success();
+    }
+
+    WfsResult Stat(const std::string &remotePath, WfsDirItem &outItem) override
+    {
+      return ReadFromOwners(remotePath, WfsCallOptions(), [&](IWfsClient &client, const WfsCallOptions &)
+                            { return client.Stat(remotePath, outItem); });
+    }
+
+    bool Exists(const std::string &remotePath) override
+    {
+      for (const Node &node : Owners(remotePath, true))
+      {
+        if (node.client->Exists(remotePath))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    WfsResult Flush() override
+    {
+      WfsResult result = WfsResult::Success();
+      for (const Node &node : AllNodes())
+      {
+        WfsResult nodeResult = node.client->Flush();
+        if (!nodeResult && result)
+        {
+          result = nodeResult;
+        }
+      }
+      return Finish(result);
+    }
+
+    // Every node has to answer
+    int8_t Ping(const WfsCallOptions &options) override
+    {
+      const CallDeadline call(options);
+      int8_t pong = -1;
+      for (const Node &node : AllNodes())
+      {
+        pong = node.client->Ping(call.RemainingOptions());
+        if (pong == -1)
+        {
+          Finish(WfsResult(false, node.client->GetLastError()));
+          break;
+        }
+      }
+      return pong;
+    }
+
+    bool IsConnected() const override
+    {
+      const auto nodes = AllNodes();
+      return std::any_of(nodes.begin(), nodes.end(), [](const Node &node)
+                         { return node.client->IsConnected(); });
+    }
+
+    bool IsAuthenticated() const override
+    {
+      const auto nodes = AllNodes();
+      return std::any_of(nodes.begin(), nodes.end(), [](const Node &node)
+                         { return node.client->IsAuthenticated(); });
+    }
+
+    WfsErrorInfo GetLastError() const override
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_lastError.error;
+    }
+
+    WfsMetricsSnapshot GetMetrics() const override
+    {
+      std::vector<WfsMetricsSnapshot> snapshots;
+      for (const Node &node : AllNodes())
+      {
+        snapshots.push_back(node.client->GetMetrics());
+      }
+      WfsMetricsSnapshot merged = MergeEndpointMetrics(snapshots);
+      if (m_hedger)
+      {
+        merged.hedgedReads = m_hedger->HedgedReads();
+        merged.hedgeWins = m_hedger->HedgeWins();
+      }
+      return merged;
+    }
+
+    void SetSlowRequestThreshold(WfsOpType op, int64_t thresholdMicros) override
+    {
+      for (const Node &node : AllNodes())
+      {
+        node.client->SetSlowRequestThreshold(op, thresholdMicros);
+      }
+    }
+
+    size_t DrainSlowRequests(std::vector<WfsSlowRequest> &outRecords, size_t maxRecords) override
+    {
+      size_t moved = 0;
+      for (const Node &node : AllNodes())
+      {
+        if (moved >= maxRecords)
+        {
+          break;
+        }
+        moved += node.client->DrainSlowRequests(outRecords, maxRecords - moved);
+      }
+      return moved;
+    }
+
+    WfsResult AddShard(const WfsEndpoint &address) override
+    {
+      std::lock_guard<std::mutex> change(m_changeMutex);
+      const auto rings = Snapshot();
+      if (!rings.first)
+      {
+        return Finish(WfsResult::Failure(-1, "Not connected to server", WfsErrorCategory::Unavailable));
+      }
+      if (Find(*rings.first, address))
+      {
+        return Finish(WfsResult::Failure(-1, "Shard already on the ring: " + EndpointName(address)));
+      }
+
+      // A node taken off the ring but not forgotten yet is still connected
+      const Node *previous = rings.second ? Find(*rings.second, address) : nullptr;
+      Node node{address, previous ? previous->client : m_factory()};
+      if (!previous)
+      {
+        WfsResult result = node.client->Connect(EndpointParams(m_params, address));
+        if (result && m_hasAuthInfo)
+        {
+          result = node.client->Authenticate(m_authInfo);
+        }
+        if (!result)
+        {
+          return Finish(result);
+        }
+      }
+
+      std::vector<Node> nodes = rings.first->nodes;
+      nodes.push_back(std::move(node));
+      Publish(std::move(nodes));
+      WFS_LOG_INFO("Shard {} added to the ring", EndpointName(address));
+      return WfsResult::Success();
+    }
+
+    WfsResult RemoveShard(const std::string &serverIp, int serverPort) override
+    {
+      std::lock_guard<std::mutex> change(m_changeMutex);
+      const auto rings = Snapshot();
+      const WfsEndpoint address(serverIp, serverPort);
+      if (!rings.first || !Find(*rings.first, address))
+      {
+        return Finish(WfsResult::Failure(-1, "Shard not on the ring: " + EndpointName(address)));
+      }
+      if (rings.first->nodes.size() == 1)
+      {
+        return Finish(WfsResult::Failure(-1, "Cannot remove the last shard"));
+      }
+
+      std::vector<Node> nodes;
+      for (const Node &node : rings.first->nodes)
+      {
+        if (EndpointName(node.address) != EndpointName(address))
+        {
+          nodes.push_back(node);
+        }
+      }
+      Publish(std::move(nodes));
+      WFS_LOG_INFO("Shard {} removed from the ring", EndpointName(address));
+      return WfsResult::Success();
+    }
+
+    void FinishRingChange() override
+    {
+      std::lock_guard<std::mutex> change(m_changeMutex);
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_previous.reset();
+    }
+
+    std::vector<WfsEndpoint> ShardsOf(const std::string &remotePath) const override
+    {
+      std::vector<WfsEndpoint> addresses;
+      for (const Node &node : Owners(remotePath, false))
+      {
+        addresses.push_back(node.address);
+      }
+      return addresses;
+    }
+
+  private:
+    struct Node
+    {
+      WfsEndpoint address;
+      std::shared_ptr<IWfsClient> client;
+    };
+
+    struct Ring
+    {
+      Ring(std::vector<Node> ringNodes, int virtualNodes)
+          : nodes(std::move(ringNodes)), hash(Addresses(nodes), virtualNodes)
+      {
+      }
+
+      static std::vector<WfsEndpoint> Addresses(const std::vector<Node> &nodes)
+      {
+        std::vector<WfsEndpoint> addresses;
+        for (const Node &node : nodes)
+        {
+          addresses.push_back(node.address);
+        }
+        return addresses;
+      }
+
+      std::vector<Node> nodes;
+      HashRing hash;
+    };
+
+    using Rings = std::pair<std::shared_ptr<const Ring>, std::shared_ptr<const Ring>>;
+
+    // Current ring and, during a change, the ring before it
+    Rings Snapshot() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return {m_ring, m_previous};
+    }
+
+    // Swap in a ring of nodes, keeping the ring before the first change
+    // for reads until FinishRingChange
+    void Publish(std::vector<Node> nodes)
+    {
+      auto ring = std::make_shared<const Ring>(std::move(nodes), m_params.sharding.virtualNodes);
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_previous)
+      {
+        m_previous = m_ring;
+      }
+      m_ring = std::move(ring);
+    }
+
+    static const Node *Find(const Ring &ring, const WfsEndpoint &address)
+    {
+      const std::string name = EndpointName(address);
+      for (const Node &node : ring.nodes)
+      {
+        if (EndpointName(node.address) == name)
+        {
+          return &node;
+        }
+      }
+      return nullptr;
+    }
+
+    static void AddUnique(std::vector<Node> &nodes, const Node &node)
+    {
+      if (std::none_of(nodes.begin(), nodes.end(), [&](const Node &known)
+                       { return known.client == node.client; }))
+      {
+        nodes.push_back(node);
+      }
+    }
+
+    static bool SameClients(const std::vector<Node> &a, const std::vector<Node> &b)
+    {
+      return a.size() == b.size() &&
+             std::all_of(a.begin(), a.end(), [&](const Node &node)
+                         { return std::any_of(b.begin(), b.end(), [&](const Node &other)
+                                              { return other.client == node.client; }); });
+    }
+
+    // Replicas of path on the current ring, primary first; with
+    // withPrevious followed by its other replicas on the previous ring
+    std::vector<Node> Owners(const std::string &path, bool withPrevious) const
+    {
+      const auto rings = Snapshot();
+      std::vector<Node> owners;
+      std::vector<size_t> indices;
+      for (const auto &ring : {rings.first, withPrevious ? rings.second : nullptr})
+      {
+        if (!ring)
+        {
+          continue;
+        }
+        ring->hash.Owners(path, m_replicas, indices);
+        for (size_t index : indices)
+        {
+          AddUnique(owners, ring->nodes[index]);
+        }
+      }
+      return owners;
+    }
+
+    std::vector<Node> AllNodes() const
+    {
+      const auto rings = Snapshot();
+      std::vector<Node> nodes;
+      for (const auto &ring : {rings.first, rings.second})
+      {
+        if (ring)
+        {
+          for (const Node &node : ring->nodes)
+          {
+            AddUnique(nodes, node);
+          }
+        }
+      }
+      return nodes;
+    }
+
+    // First owner (current ring first, then the previous one) that answers
+    template <typename Call>
+    WfsResult ReadFromOwners(const std::string &path, const WfsCallOptions &options, Call &&callClient)
+    {
+      const CallDeadline call(options);
+      WfsResult result = WfsResult::Failure(-1, "No shard owns " + path);
+      for (const Node &node : Owners(path, true))
+      {
+        result = callClient(*node.client, call.RemainingOptions());
+        if (result || !call.Status())
+        {
+          break;
+        }
+      }
+      return Finish(result);
+    }
+
+    // Download racing the first two owners, then trying the others in turn
+    WfsResult HedgedDownload(const std::string &remotePath, std::vector<Node> owners,
+                             std::shared_ptr<const std::string> &outData, const WfsCallOptions &options)
+    {
+      const CallDeadline call(options);
+      auto attempt = [owners, remotePath](int index, const WfsCallOptions &attemptOptions,
+                                          std::shared_ptr<const std::string> &data)
+      { return owners[index].client->DownloadFileShared(remotePath, data, attemptOptions); };
+      WfsResult result = m_hedger->Read(true, call, std::move(attempt), [](const WfsResult &)
+                                        { return true; }, outData);
+      for (size_t i = 2; i < owners.size() && !result && call.Status(); ++i)
+      {
+        result = owners[i].client->DownloadFileShared(remotePath, outData, call.RemainingOptions());
+      }
+      return Finish(result);
+    }
+
+    // Apply to every node; succeeds if any node does
+    template <typename Call>
+    WfsResult ForAll(Call &&callNode)
+    {
+      WfsResult result = WfsResult::Failure(-1, "No shards configured");
+      bool any = false;
+      for (const Node &node : AllNodes())
+      {
+        WfsResult nodeResult = callNode(node);
+        if (nodeResult)
+        {
+          any = true;
+          result = nodeResult;
+        }
+        else
+        {
+          WFS_LOG_WARN("Shard {}: {}", EndpointName(node.address), nodeResult.error.info);
+          if (!any)
+          {
+            result = nodeResult;
+          }
+        }
+      }
+      return Finish(result);
+    }
+
+    WfsResult Finish(const WfsResult &result)
+    {
+      if (!result)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lastError = result;
+      }
+      return result;
+    }
+
+    const ClientFactory m_factory;
+
+    // Serializes Connect/Authenticate and ring changes
+    std::mutex m_changeMutex;
+    WfsConnectionParams m_params;
+    WfsAuthInfo m_authInfo;
+    bool m_hasAuthInfo{false};
+    size_t m_replicas{1};
+
+    mutable std::mutex m_mutex;
+    std::shared_ptr<const Ring> m_ring;
+    std::shared_ptr<const Ring> m_previous;
+    WfsResult m_lastError;
+
+    // Set by Connect with hedging
+    std::unique_ptr<HedgedReader> m_hedger;
+  };
+
+} // namespace wfs_client
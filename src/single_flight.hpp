@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "wfs_client/datatype_.hpp"
+
+namespace wfs_client
+{
+
+  // Request coalescing: concurrent calls with the same key share one execution
+  // and every caller receives the same immutable result buffer
+  template <typename T>
+  class SingleFlight
+  {
+  public:
+    struct Outcome
+    {
+      WfsResult result;
+      std::shared_ptr<const T> value;
+    };
+
+    // Run fn for key, or wait for the call already in flight for key
+    template <typename Fn>
+    Outcome Do(const std::string &key, Fn &&fn)
+    {
+      std::shared_ptr<Call> call;
+      bool leader = false;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_calls.find(key);
+        if (it != m_calls.end())
+        {
+          call = it->second;
+        }
+        else
+        {
+          call = std::make_shared<Call>();
+          m_calls.emplace(key, call);
+          leader = true;
+        }
+      }
+
+      if (!leader)
+      {
+        m_shared.fetch_add(1, std::memory_order_relaxed);
+        std::unique_lock<std::mutex> lock(call->mutex);
+        call->cv.wait(lock, [&call]()
+                      { return call->done; });
+        return call->outcome;
+      }
+
+      Outcome outcome;
+      try
+      {
+        outcome = fn();
+      }
+      catch (const std::exception &e)
+      {
+        outcome.result = WfsResult::Failure(-1, std::string("Standard exception: ") + e.what());
+      }
+      catch (...)
+      {
+        outcome.result = WfsResult::Failure(-1, "Unknown exception");
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_calls.find(key);
+        if (it != m_calls.end() && it->second == call)
+        {
+          m_calls.erase(it);
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(call->mutex);
+        call->outcome = outcome;
+        call->done = true;
+      }
+      call->cv.notify_all();
+      return outcome;
+    }
+
+    // Detach the in-flight call for key so later callers start a fresh one,
+    // used after a write makes the pending result stale
+    void Forget(const std::string &key)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_calls.erase(key);
+    }
+
+    // Number of calls answered by another caller's execution
+    uint64_t SharedCount() const
+    {
+      return m_shared.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Call
+    {
+      std::mutex mutex;
+      std::condition_variable cv;
+      bool done{false};
+      Outcome outcome;
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<Call>> m_calls;
+    std::atomic<uint64_t> m_shared{0};
+  };
+
+} // namespace wfs_client
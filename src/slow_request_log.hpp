@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "wfs_client/metrics.hpp"
+
+namespace wfs_client
+{
+
+  // Bounded lock-free MPMC ring (Vyukov-style sequence numbers) of slow
+  // request records. Producers never block: a record is dropped (and
+  // counted) when the ring is full. Slots keep their path capacity, so a
+  // warmed-up ring does not allocate for typical paths.
+  class SlowRequestLog
+  {
+  public:
+    explicit SlowRequestLog(size_t capacity)
+    {
+      size_t size = 2;
+      while (size < capacity)
+      {
+        size <<= 1;
+      }
+      m_mask = size - 1;
+      m_slots = std::make_unique<Slot[]>(size);
+      for (size_t i = 0; i < size; ++i)
+      {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+      }
+      for (auto &threshold : m_thresholdNanos)
+      {
+        threshold.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    SlowRequestLog(const SlowRequestLog &) = delete;
+    SlowRequestLog &operator=(const SlowRequestLog &) = delete;
+
+    // 0 disables logging of op
+    void SetThreshold(WfsOpType op, int64_t thresholdMicros)
+    {
+      const uint64_t nanos = thresholdMicros > 0 ? static_cast<uint64_t>(thresholdMicros) * 1000 : 0;
+      m_thresholdNanos[static_cast<size_t>(op)].store(nanos, std::memory_order_relaxed);
+    }
+
+    bool IsSlow(WfsOpType op, uint64_t elapsedNanos) const
+    {
+      const uint64_t threshold = m_thresholdNanos[static_cast<size_t>(op)].load(std::memory_order_relaxed);
+      return threshold != 0 && elapsedNanos >= threshold;
+    }
+
+    void Push(const WfsSlowRequest &record)
+    {
+      size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+      for (;;)
+      {
+        Slot &slot = m_slots[pos & m_mask];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0)
+        {
+          if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          {
+            slot.record = record;
+            slot.sequence.store(pos + 1, std::memory_order_release);
+            return;
+          }
+        }
+        else if (diff < 0)
+        {
+          m_dropped.fetch_add(1, std::memory_order_relaxed);
+          return;
+        }
+        else
+        {
+          pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    // Move up to maxRecords records into out; returns the number moved
+    size_t Drain(std::vector<WfsSlowRequest> &out, size_t maxRecords)
+    {
+      size_t drained = 0;
+      size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+      while (drained < maxRecords)
+      {
+        Slot &slot = m_slots[pos & m_mask];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0)
+        {
+          if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          {
+            out.push_back(slot.record);
+            slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+            ++drained;
+            ++pos;
+          }
+        }
+        else if (diff < 0)
+        {
+          break;
+        }
+        else
+        {
+          pos = m_dequeuePos.load(std::memory_order_relaxed);
+        }
+      }
+      return drained;
+    }
+
+    uint64_t Dropped() const
+    {
+      return m_dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct alignas(64) Slot
+    {
+      std::atomic<size_t> sequence{0};
+      WfsSlowRequest record;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask{0};
+    std::atomic<uint64_t> m_thresholdNanos[kWfsOpTypeCount];
+    alignas(64) std::atomic<size_t> m_enqueuePos{0};
+    alignas(64) std::atomic<size_t> m_dequeuePos{0};
+    std::atomic<uint64_t> m_dropped{0};
+  };
+
+} // namespace wfs_client
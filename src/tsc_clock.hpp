@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define WFS_CLIENT_HAVE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define WFS_CLIENT_HAVE_RDTSC 1
+#endif
+
+namespace wfs_client
+{
+
+  // Cheap monotonic tick counter for hot-path timing: the CPU timestamp
+  // counter on x86 (invariant TSC), the virtual counter on ARM64 and
+  // steady_clock elsewhere. Ticks are converted to nanoseconds with a ratio
+  // calibrated once against steady_clock.
+  class TscClock
+  {
+  public:
+    static uint64_t Now()
+    {
+#if defined(WFS_CLIENT_HAVE_RDTSC)
+      return __rdtsc();
+#elif defined(__aarch64__)
+      uint64_t ticks;
+      asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+      return ticks;
+#else
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now().time_since_epoch())
+                                       .count());
+#endif
+    }
+
+    // Ticks between two readings; clamped at zero in case a thread migrated
+    // to a core whose counter is slightly behind
+    static uint64_t Elapsed(uint64_t start, uint64_t end)
+    {
+      return end > start ? end - start : 0;
+    }
+
+    static uint64_t ToNanos(uint64_t ticks)
+    {
+      return static_cast<uint64_t>(static_cast<double>(ticks) * NanosPerTick());
+    }
+
+    static double NanosPerTick()
+    {
+      static const double ratio = Calibrate();
+      return ratio;
+    }
+
+  private:
+    // Spin for ~2 ms and compare both clocks
+    static double Calibrate()
+    {
+      using Steady = std::chrono::steady_clock;
+      const auto steadyStart = Steady::now();
+      const uint64_t tickStart = Now();
+      auto steadyEnd = steadyStart;
+      while (steadyEnd - steadyStart < std::chrono::milliseconds(2))
+      {
+        steadyEnd = Steady::now();
+      }
+      const uint64_t tickEnd = Now();
+
+      const double nanos = static_cast<double>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(steadyEnd - steadyStart).count());
+      return tickEnd > tickStart ? nanos / static_cast<double>(tickEnd - tickStart) : 1.0;
+    }
+  };
+
+} // namespace wfs_client
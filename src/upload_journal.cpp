@@ -0,0 +1,469 @@
+#include "upload_journal.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "wfs_log.hpp"
+
+namespace wfs_client
+{
+
+  namespace
+  {
+
+    constexpr uint32_t kRecordMagic = 0x4A534657; // "WFSJ"
+    constexpr size_t kRecordHeaderSize = 4 + 4 + 8 + 1 + 4;
+    constexpr const char *kSegmentPrefix = "segment-";
+    constexpr const char *kSegmentSuffix = ".wfsj";
+
+    // CRC-32 (IEEE), guards against torn or corrupted records
+    uint32_t Crc32(uint32_t crc, const char *data, size_t size)
+    {
+      static const std::array<uint32_t, 256> table = []()
+      {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+          uint32_t c = i;
+          for (int k = 0; k < 8; ++k)
+          {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+          }
+          t[i] = c;
+        }
+        return t;
+      }();
+
+      crc = ~crc;
+      for (size_t i = 0; i < size; ++i)
+      {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+      }
+      return ~crc;
+    }
+
+    void PutLe(char *out, uint64_t value, size_t bytes)
+    {
+      for (size_t i = 0; i < bytes; ++i)
+      {
+        out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+      }
+    }
+
+    uint64_t GetLe(const char *in, size_t bytes)
+    {
+      uint64_t value = 0;
+      for (size_t i = 0; i < bytes; ++i)
+      {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+      }
+      return value;
+    }
+
+    void SyncFile(FILE *file)
+    {
+      fflush(file);
+#ifdef _WIN32
+      _commit(_fileno(file));
+#else
+      fsync(fileno(file));
+#endif
+    }
+
+    // Parse a segment; stops at the first truncated or corrupted record
+    std::vector<WfsFileData> ReadSegment(const std::string &path)
+    {
+      std::vector<WfsFileData> records;
+      std::ifstream file(path, std::ios::binary);
+      if (!file)
+      {
+        return records;
+      }
+      std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+      size_t offset = 0;
+      while (content.size() - offset >= kRecordHeaderSize)
+      {
+        const char *header = content.data() + offset;
+        const uint32_t magic = static_cast<uint32_t>(GetLe(header, 4));
+        const uint64_t nameSize = GetLe(header + 4, 4);
+        const uint64_t dataSize = GetLe(header + 8, 8);
+        const int8_t compress = static_cast<int8_t>(header[16]);
+        const uint32_t crc = static_cast<uint32_t>(GetLe(header + 17, 4));
+
+        const size_t remaining = content.size() - offset - kRecordHeaderSize;
+        if (magic != kRecordMagic || nameSize > remaining || dataSize > remaining - nameSize)
+        {
+          WFS_LOG_WARN("Journal segment {} truncated at offset {}", path, offset);
+          break;
+        }
+
+        const char *payload = header + kRecordHeaderSize;
+        if (Crc32(Crc32(0, payload, nameSize), payload + nameSize, dataSize) != crc)
+        {
+          WFS_LOG_WARN("Journal segment {} corrupted at offset {}", path, offset);
+          break;
+        }
+
+        records.emplace_back(std::string(payload, nameSize),
+                             std::string(payload + nameSize, dataSize), compress);
+        offset += kRecordHeaderSize + nameSize + dataSize;
+      }
+      return records;
+    }
+
+  } // namespace
+
+  UploadJournal::UploadJournal(const Options &options, JournalChannelFactory channelFactory)
+      : m_options(options), m_channelFactory(std::move(channelFactory))
+  {
+    m_options.drainConnections = std::max<size_t>(1, m_options.drainConnections);
+    m_options.pipelineDepth = std::max<size_t>(1, m_options.pipelineDepth);
+  }
+
+  UploadJournal::~UploadJournal()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_drainThread.joinable())
+    {
+      m_drainThread.join();
+    }
+
+    // Pending records stay on disk for the next run
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SealActiveSegment();
+  }
+
+  WfsResult UploadJournal::Open()
+  {
+    namespace fs = std::filesystem;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::error_code ec;
+    fs::create_directories(m_options.directory, ec);
+    if (ec)
+    {
+      return WfsResult::Failure(-1, "Cannot create journal directory: " + ec.message());
+    }
+
+    const std::string prefix = kSegmentPrefix;
+    const std::string suffix = kSegmentSuffix;
+    for (const auto &entry : fs::directory_iterator(m_options.directory, ec))
+    {
+      const std::string name = entry.path().filename().string();
+      if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+          name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+      {
+        continue;
+      }
+
+      const uint64_t sequence = std::strtoull(name.c_str() + prefix.size(), nullptr, 10);
+      if (entry.file_size(ec) == 0)
+      {
+        fs::remove(entry.path(), ec);
+        continue;
+      }
+      m_sealed.push_back(Segment{sequence, entry.path().string()});
+      m_nextSequence = std::max(m_nextSequence, sequence + 1);
+    }
+    std::sort(m_sealed.begin(), m_sealed.end(), [](const Segment &a, const Segment &b)
+              { return a.sequence < b.sequence; });
+
+    if (!m_sealed.empty())
+    {
+      WFS_LOG_INFO("Upload journal has {} pending segment(s) to replay",
+                   m_sealed.size());
+      m_wake = true;
+    }
+
+    m_drainThread = std::thread([this]()
+                                { DrainLoop(); });
+    return WfsResult::Success();
+  }
+
+  WfsResult UploadJournal::Append(const WfsFileData &fileData)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_active)
+    {
+      WfsResult opened = OpenActiveSegment();
+      if (!opened)
+      {
+        return opened;
+      }
+    }
+
+    char header[kRecordHeaderSize];
+    PutLe(header, kRecordMagic, 4);
+    PutLe(header + 4, fileData.name.size(), 4);
+    PutLe(header + 8, fileData.data.size(), 8);
+    header[16] = static_cast<char>(fileData.compress);
+    PutLe(header + 17,
+          Crc32(Crc32(0, fileData.name.data(), fileData.name.size()),
+                fileData.data.data(), fileData.data.size()),
+          4);
+
+    if (fwrite(header, 1, sizeof(header), m_active) != sizeof(header) ||
+        fwrite(fileData.name.data(), 1, fileData.name.size(), m_active) != fileData.name.size() ||
+        fwrite(fileData.data.data(), 1, fileData.data.size(), m_active) != fileData.data.size() ||
+        fflush(m_active) != 0)
+    {
+      return WfsResult::Failure(-1, "Failed to write journal segment: " + m_activePath);
+    }
+    m_activeBytes += sizeof(header) + fileData.name.size() + fileData.data.size();
+    const bool wasUnsynced = m_unsynced;
+    m_unsynced = true;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (m_options.sync == WfsJournalSync::Always ||
+        (m_options.sync == WfsJournalSync::Interval && now - m_lastSync >= m_options.syncInterval))
+    {
+      SyncActiveSegment();
+    }
+    else if (m_options.sync == WfsJournalSync::Interval && !wasUnsynced)
+    {
+      // The drain thread schedules the timed sync
+      m_cv.notify_all();
+    }
+
+    if (m_activeBytes >= m_options.segmentBytes)
+    {
+      SealActiveSegment();
+    }
+    return WfsResult::Success();
+  }
+
+  bool UploadJournal::HasPending() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_sealed.empty() || m_activeBytes > 0;
+  }
+
+  void UploadJournal::Wake()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_sealed.empty() && m_activeBytes == 0)
+      {
+        return;
+      }
+      m_wake = true;
+    }
+    m_cv.notify_all();
+  }
+
+  std::string UploadJournal::SegmentPath(uint64_t sequence) const
+  {
+    return (std::filesystem::path(m_options.directory) /
+            fmt::format("{}{:020}{}", kSegmentPrefix, sequence, kSegmentSuffix))
+        .string();
+  }
+
+  WfsResult UploadJournal::OpenActiveSegment()
+  {
+    m_activeSequence = m_nextSequence++;
+    m_activePath = SegmentPath(m_activeSequence);
+    m_active = fopen(m_activePath.c_str(), "ab");
+    if (!m_active)
+    {
+      return WfsResult::Failure(-1, "Cannot create journal segment: " + m_activePath);
+    }
+    m_activeBytes = 0;
+    m_lastSync = std::chrono::steady_clock::now();
+    m_unsynced = false;
+    return WfsResult::Success();
+  }
+
+  void UploadJournal::SyncActiveSegment()
+  {
+    SyncFile(m_active);
+    m_lastSync = std::chrono::steady_clock::now();
+    m_unsynced = false;
+  }
+
+  void UploadJournal::SealActiveSegment()
+  {
+    if (!m_active)
+    {
+      return;
+    }
+    if (m_options.sync != WfsJournalSync::None)
+    {
+      SyncActiveSegment();
+    }
+    fclose(m_active);
+    m_active = nullptr;
+
+    if (m_activeBytes > 0)
+    {
+      m_sealed.push_back(Segment{m_activeSequence, m_activePath});
+    }
+    else
+    {
+      std::error_code ec;
+      std::filesystem::remove(m_activePath, ec);
+    }
+    m_activeBytes = 0;
+  }
+
+  void UploadJournal::DrainLoop()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto retryAt = std::chrono::steady_clock::now() + m_options.retryInterval;
+    while (!m_stopping)
+    {
+      // With interval sync, also wake when unsynced records fall due, so
+      // they reach the disk even if no further Append comes
+      const bool unsynced = m_options.sync == WfsJournalSync::Interval && m_unsynced;
+      const auto wakeAt = unsynced ? std::min(retryAt, m_lastSync + m_options.syncInterval) : retryAt;
+      m_cv.wait_until(lock, wakeAt, [this, unsynced]()
+                      { return m_stopping || m_wake || (m_options.sync == WfsJournalSync::Interval && m_unsynced != unsynced); });
+
+      const auto now = std::chrono::steady_clock::now();
+      if (m_options.sync == WfsJournalSync::Interval && m_unsynced && m_active &&
+          now - m_lastSync >= m_options.syncInterval)
+      {
+        SyncActiveSegment();
+      }
+      if (!m_stopping && !m_wake && now < retryAt)
+      {
+        continue;
+      }
+      m_wake = false;
+      retryAt = now + m_options.retryInterval;
+      if (m_stopping || (m_sealed.empty() && m_activeBytes == 0))
+      {
+        continue;
+      }
+
+      // Open the replay connections; give up until the next attempt if the
+      // server is still unreachable
+      lock.unlock();
+      std::vector<std::unique_ptr<IJournalChannel>> channels;
+      for (size_t i = 0; i < m_options.drainConnections; ++i)
+      {
+        auto channel = m_channelFactory();
+        if (!channel)
+        {
+          break;
+        }
+        channels.push_back(std::move(channel));
+      }
+      lock.lock();
+      if (channels.empty())
+      {
+        continue;
+      }
+
+      while (!m_stopping)
+      {
+        // Records written meanwhile are replayed after the older segments
+        SealActiveSegment();
+        if (m_sealed.empty())
+        {
+          break;
+        }
+
+        const Segment segment = m_sealed.front();
+        lock.unlock();
+        const bool delivered = DrainSegment(segment, channels);
+        lock.lock();
+        if (!delivered)
+        {
+          break;
+        }
+
+        std::error_code ec;
+        std::filesystem::remove(segment.path, ec);
+        m_sealed.pop_front();
+      }
+
+      lock.unlock();
+      channels.clear();
+      lock.lock();
+    }
+  }
+
+  bool UploadJournal::DrainSegment(const Segment &segment,
+                                   std::vector<std::unique_ptr<IJournalChannel>> &channels)
+  {
+    const std::vector<WfsFileData> records = ReadSegment(segment.path);
+
+    // All records of a path go to the same connection, in journal order
+    std::vector<std::vector<const WfsFileData *>> shards(channels.size());
+    std::hash<std::string> hasher;
+    for (const auto &record : records)
+    {
+      shards[hasher(record.name) % shards.size()].push_back(&record);
+    }
+
+    std::atomic<bool> failed{false};
+    std::atomic<size_t> rejected{0};
+    auto replay = [&](size_t index)
+    {
+      const auto &shard = shards[index];
+      for (size_t begin = 0; begin < shard.size() && !failed.load(); begin += m_options.pipelineDepth)
+      {
+        const size_t end = std::min(shard.size(), begin + m_options.pipelineDepth);
+        std::vector<const WfsFileData *> chunk(shard.begin() + begin, shard.begin() + end);
+        std::vector<WfsResult> results = channels[index]->Append(chunk);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+          if (!results[i])
+          {
+            // Rejected by the server: retrying cannot succeed, drop it
+            WFS_LOG_ERROR("Journal replay rejected: {} - {} - {}",
+                          chunk[i]->name, results[i].error.code, results[i].error.info);
+            ++rejected;
+          }
+        }
+        if (results.size() < chunk.size())
+        {
+          failed = true;
+        }
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < shards.size(); ++i)
+    {
+      if (!shards[i].empty())
+      {
+        workers.emplace_back(replay, i);
+      }
+    }
+    replay(0);
+    for (auto &worker : workers)
+    {
+      worker.join();
+    }
+
+    if (failed)
+    {
+      WFS_LOG_WARN("Journal replay of {} interrupted, will retry", segment.path);
+      return false;
+    }
+
+    WFS_LOG_INFO("Journal segment replayed: {} ({} records, {} rejected)",
+                 segment.path, records.size(), rejected.load());
+    return true;
+  }
+
+} // namespace wfs_client
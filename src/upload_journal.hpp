@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wfs_client/datatype_.hpp"
+
+namespace wfs_client
+{
+
+  // Connection used to replay journal records
+  class IJournalChannel
+  {
+  public:
+    virtual ~IJournalChannel() = default;
+
+    // Append files in order (pipelined); returns one result per reply and
+    // fewer results than files when the connection failed
+    virtual std::vector<WfsResult> Append(const std::vector<const WfsFileData *> &files) = 0;
+  };
+
+  // Opens a replay channel, or returns nullptr while the server is unreachable
+  using JournalChannelFactory = std::function<std::unique_ptr<IJournalChannel>()>;
+
+  // Durable offline upload journal. Uploads are appended to segmented local
+  // files and replayed by a background thread over several parallel
+  // connections once the server is reachable. Records of one path always go
+  // to the same connection in journal order, so per-path ordering survives
+  // replay. Delivery is at-least-once: a segment is deleted only after every
+  // record in it has been acknowledged.
+  class UploadJournal
+  {
+  public:
+    struct Options
+    {
+      std::string directory;
+      uint64_t segmentBytes{64 * 1024 * 1024};
+      WfsJournalSync sync{WfsJournalSync::Interval};
+      std::chrono::milliseconds syncInterval{1000};
+      size_t drainConnections{4};
+      size_t pipelineDepth{16};
+      std::chrono::milliseconds retryInterval{5000};
+    };
+
+    UploadJournal(const Options &options, JournalChannelFactory channelFactory);
+    ~UploadJournal();
+
+    UploadJournal(const UploadJournal &) = delete;
+    UploadJournal &operator=(const UploadJournal &) = delete;
+
+    // Create the journal directory, pick up segments left by a previous run
+    // and start the drain thread
+    WfsResult Open();
+
+    // Durably record an upload (subject to the sync policy)
+    WfsResult Append(const WfsFileData &fileData);
+
+    // True while records are waiting for replay; new uploads must then go
+    // through the journal too so they cannot overtake older records
+    bool HasPending() const;
+
+    // Hint that the server is reachable again, starts a drain attempt now
+    void Wake();
+
+  private:
+    struct Segment
+    {
+      uint64_t sequence;
+      std::string path;
+    };
+
+    std::string SegmentPath(uint64_t sequence) const;
+    WfsResult OpenActiveSegment();
+    void SealActiveSegment();
+    void SyncActiveSegment();
+    void DrainLoop();
+    bool DrainSegment(const Segment &segment,
+                      std::vector<std::unique_ptr<IJournalChannel>> &channels);
+
+    Options m_options;
+    JournalChannelFactory m_channelFactory;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Segment> m_sealed;
+    FILE *m_active{nullptr};
+    std::string m_activePath;
+    uint64_t m_activeSequence{0};
+    uint64_t m_activeBytes{0};
+    uint64_t m_nextSequence{1};
+    std::chrono::steady_clock::time_point m_lastSync;
+    bool m_unsynced{false}; // active segment written since the last sync
+    bool m_wake{false};
+    bool m_stopping{false};
+    std::thread m_drainThread;
+  };
+
+} // namespace wfs_client
@@ -1,8 +1,12 @@
+#ifdef _WIN32
 #include <Windows.h>
-#include <fmt/core.h>
 #include <locale>
 #include <iostream>
+#endif
 #include "wfs_client/iwfs_client.hpp"
+#include "wfs_log.hpp"
+
+#ifdef _WIN32
 
 // Set UTF-8 console code page
 void SetUtf8Console()
@@ -15,7 +19,7 @@ void SetUtf8Console()
   std::locale::global(std::locale(""));
   std::ios_base::sync_with_stdio(false);
 
-  fmt::print("Console set to UTF-8 encoding\n");
+  WFS_LOG_DEBUG("Console set to UTF-8 encoding");
 }
 
 // Module initialization function, set console encoding
@@ -34,5 +38,6 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
   }
   return TRUE;
 }
+#endif // _WIN32
 
 // The implementation of client factory function is in wfs_client_impl.cpp
\ No newline at end of file
@@ -1,11 +1,14 @@
+#ifdef _WIN32
 #include <Windows.h>
-#include <fmt/color.h>
-#include <fmt/core.h>
+#endif
 #include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/protocol/TProtocolException.h>
 #include <thrift/transport/TSocket.h>
 #include <thrift/transport/TTransportException.h>
 #include <thrift/transport/TTransportUtils.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <mutex>
 #include <iostream>
@@ -15,7 +18,29 @@
 
 #include "gen-cpp/WfsIface.h"
 #include "gen-cpp/wfs_types.h"
+#include "wfs_client/fault_injection.hpp"
+#include "wfs_client/interceptor.hpp"
 #include "wfs_client/iwfs_client.hpp"
+#include "wfs_client/sharding.hpp"
+#include "wfs_client/utils.hpp"
+#include "balanced_client.hpp"
+#include "call_deadline.hpp"
+#include "circuit_breaker.hpp"
+#include "dir_listing_cache.hpp"
+#include "health_checker.hpp"
+#include "single_flight.hpp"
+#include "upload_journal.hpp"
+#include "wfs_log.hpp"
+#include "retry_backoff.hpp"
+#include "sharded_client.hpp"
+#include "rpc_scope.hpp"
+#include "slow_request_log.hpp"
+#include "tsc_clock.hpp"
+#include "wfs_metrics.hpp"
+#include "wfs_probes.hpp"
+#include "wfs_tracing.hpp"
+#include "wfs_session.hpp"
+#include "write_behind_queue.hpp"
 
 using namespace apache::thrift;
 using namespace apache::thrift::protocol;
@@ -57,56 +82,135 @@ namespace wfs_client
     }
   }
 
+  // Journal replay over an independent authenticated connection
+  class SessionJournalChannel : public IJournalChannel
+  {
+  public:
+    SessionJournalChannel(const WfsConnectionParams &params, const WfsAuthInfo &authInfo)
+        : m_session(params, authInfo)
+    {
+    }
+
+    bool Open()
+    {
+      return m_session.Open();
+    }
+
+    std::vector<WfsResult> Append(const std::vector<const WfsFileData *> &files) override
+    {
+      return m_session.Append(files);
+    }
+
+  private:
+    WfsSession m_session;
+  };
+
   // Actual client implementation
   class WfsClientImpl : public IWfsClient
   {
   public:
-    WfsClientImpl()
+    explicit WfsClientImpl(std::vector<std::shared_ptr<IWfsInterceptor>> interceptors = {})
         : m_isConnected(false),
-          m_isAuthenticated(false)
+          m_isAuthenticated(false),
+          m_interceptors(std::move(interceptors))
     {
     }
 
     ~WfsClientImpl() override
     {
+      m_healthChecker.reset();
+      // Write out queued uploads while still connected
+      m_writeBehind.reset();
+      m_journal.reset();
       Disconnect();
     }
 
     WfsResult Connect(const WfsConnectionParams &params) override
     {
-      std::lock_guard<std::mutex> lock(m_mutex);
+      std::lock_guard<std::timed_mutex> lock(m_mutex);
 
       if (m_isConnected)
       {
-        Disconnect();
+        DisconnectInternal();
       }
 
       m_params = params;
+      m_listingCache.SetTtl(std::chrono::milliseconds(m_params.listingCacheTtl));
+      if (m_params.slowRequestThreshold > 0)
+      {
+        const int64_t thresholdMicros = static_cast<int64_t>(m_params.slowRequestThreshold) * 1000;
+        m_slowLog.SetThreshold(WfsOpType::Append, thresholdMicros);
+        m_slowLog.SetThreshold(WfsOpType::Get, thresholdMicros);
+        m_slowLog.SetThreshold(WfsOpType::List, thresholdMicros);
+      }
+      if (m_params.writeBehind && !m_writeBehind)
+      {
+        m_writeBehind = std::make_unique<WriteBehindQueue>(
+            [this](const WriteBehindQueue::Batch &batch)
+            { return AppendBatch(batch); },
+            std::chrono::milliseconds(m_params.writeBehindFlushInterval),
+            static_cast<size_t>(std::max(1, m_params.writeBehindMaxBatch)),
+            static_cast<size_t>(std::max<int64_t>(0, m_params.writeBehindMaxQueuedBytes)));
+      }
+      if (!m_params.journalDir.empty() && !m_journal)
+      {
+        OpenJournal();
+      }
+      if (m_params.adaptiveTimeout.enabled && !m_rtt)
+      {
+        m_rtt = std::make_unique<RttEstimator>(m_params.adaptiveTimeout, m_params.receiveTimeout);
+      }
+      if (m_params.circuitBreaker.enabled && !m_breaker)
+      {
+        m_breaker = std::make_unique<CircuitBreaker>(m_params.circuitBreaker);
+      }
+      if (m_params.keepalive.enabled && !m_healthChecker)
+      {
+        m_healthChecker = std::make_unique<HealthChecker>(
+            [this]()
+            { CheckHealth(); },
+            std::chrono::milliseconds(std::max(100, m_params.keepalive.idleInterval / 2)));
+      }
+      m_wantConnection = true;
       return ConnectInternal();
     }
 
     WfsResult Reconnect() override
     {
-      std::lock_guard<std::mutex> lock(m_mutex);
+      std::lock_guard<std::timed_mutex> lock(m_mutex);
 
+      // Keep the session the caller had, if any
+      const bool restoreSession = m_wantSession;
       if (m_isConnected)
       {
-        Disconnect();
+        DisconnectInternal();
       }
+      m_wantConnection = true;
+      m_wantSession = restoreSession;
 
-      return ConnectInternal();
+      WfsResult result = ConnectInternal();
+      if (result && restoreSession)
+      {
+        result = AuthenticateInternal();
+      }
+      return result;
     }
 
     void Disconnect() override
     {
-      std::lock_guard<std::mutex> lock(m_mutex);
+      std::lock_guard<std::timed_mutex> lock(m_mutex);
+      DisconnectInternal();
+    }
 
+    // Disconnect with the client lock held
+    void DisconnectInternal()
+    {
       if (m_isConnected && m_client)
       {
         try
         {
           m_client->getInputProtocol()->getTransport()->close();
-          fmt::print(fg(fmt::color::red), "WFS client is disconnected\n");
+          WFS_LOG_INFO("WFS client is disconnected");
         }
         catch (...)
         {
@@ -114,58 +218,569 @@ namespace wfs_client
         }
       }
 
-      m_isConnected = false;
+      SetConnected(false);
       m_isAuthenticated = false;
+      m_wantConnection = false;
+      m_wantSession = false;
       m_client.reset();
     }
 
     WfsResult Authenticate(const WfsAuthInfo &authInfo) override
     {
-      std::lock_guard<std::mutex> lock(m_mutex);
+      std::lock_guard<std::timed_mutex> lock(m_mutex);
 
+      m_authInfo = authInfo;
       if (!EnsureConnected())
       {
+        // Sign in as soon as a later call gets the connection back
+        m_wantSession = m_wantConnection;
         return m_lastError;
       }
 
-      m_authInfo = authInfo;
       return AuthenticateInternal();
     }
 
-    WfsResult UploadFile(const WfsFileData &fileData) override
+    WfsResult UploadFile(const WfsFileData &fileData, const WfsCallOptions &options) override
     {
-      std::lock_guard<std::mutex> lock(m_mutex);
+      const CallDeadline call(options);
+      if (m_interceptors.empty())
+      {
+        return DoUploadFile(fileData, call);
+      }
+      WfsRequest request;
+      request.op = WfsOpType::Append;
+      request.path = &fileData.name;
+      request.file = &fileData;
+      request.options = &options;
+      return Intercept(request, [&](WfsResponse &response)
+                       { response.result = DoUploadFile(fileData, call); })
+          .result;
+    }
 
-      if (!EnsureConnectedAndAuthenticated())
+    WfsResult DownloadFile(const std::string &remotePath, std::string &outData,
+                           const WfsCallOptions &options) override
+    {
+      std::shared_ptr<const std::string> sharedData;
+      WfsResult result = DownloadFileShared(remotePath, sharedData, options);
+      if (result && sharedData)
       {
-        return m_lastError;
+        outData = *sharedData;
+      }
+      return result;
+    }
+
+    WfsResult DownloadFileShared(const std::string &remotePath,
+                                 std::shared_ptr<const std::string> &outData,
+                                 const WfsCallOptions &options) override
+    {
+      const CallDeadline call(options);
+      if (m_interceptors.empty())
+      {
+        return DoDownloadFileShared(remotePath, outData, call);
+      }
+      WfsRequest request;
+      request.op = WfsOpType::Get;
+      request.path = &remotePath;
+      request.options = &options;
+      WfsResponse outcome = Intercept(request, [&](WfsResponse &response)
+                                      { response.result = DoDownloadFileShared(remotePath, response.data, call); });
+      outData = std::move(outcome.data);
+      return outcome.result;
+    }
+
+    WfsResult DeleteFile(const std::string &remotePath, const WfsCallOptions &options) override
+    {
+      const CallDeadline call(options);
+      if (m_interceptors.empty())
+      {
+        return DoDeleteFile(remotePath, call);
+      }
+      WfsRequest request;
+      request.op = WfsOpType::Delete;
+      request.path = &remotePath;
+      request.options = &options;
+      return Intercept(request, [&](WfsResponse &response)
+                       { response.result = DoDeleteFile(remotePath, call); })
+          .result;
+    }
+
+    WfsResult RenameFile(const std::string &oldPath, const std::string &newPath,
+                         const WfsCallOptions &options) override
+    {
+      const CallDeadline call(options);
+      if (m_interceptors.empty())
+      {
+        return DoRenameFile(oldPath, newPath, call);
+      }
+      WfsRequest request;
+      request.op = WfsOpType::Rename;
+      request.path = &oldPath;
+      request.newPath = &newPath;
+      request.options = &options;
+      return Intercept(request, [&](WfsResponse &response)
+                       { response.result = DoRenameFile(oldPath, newPath, call); })
+          .result;
+    }
+
+    WfsResult ListDirectory(const std::string &remotePath, WfsDirList &outDirList,
+                            const WfsCallOptions &options) override
+    {
+      const CallDeadline call(options);
+      std::shared_ptr<const WfsDirList> dirList;
+      WfsResult result;
+      if (m_interceptors.empty())
+      {
+        result = DoListDirectory(remotePath, dirList, call);
+      }
+      else
+      {
+        WfsRequest request;
+        request.op = WfsOpType::List;
+        request.path = &remotePath;
+        request.options = &options;
+        WfsResponse outcome = Intercept(request, [&](WfsResponse &response)
+                                        { response.result = DoListDirectory(remotePath, response.dirList, call); });
+        dirList = std::move(outcome.dirList);
+        result = outcome.result;
+      }
+      if (dirList)
+      {
+        outDirList = *dirList;
+      }
+      return result;
+    }
+
+    WfsResult Stat(const std::string &remotePath, WfsDirItem &outItem) override
+    {
+      if (m_writeBehind)
+      {
+        if (auto pending = m_writeBehind->Pending(remotePath))
+        {
+          outItem = WfsDirItem(utils::getFileName(remotePath),
+                               static_cast<int64_t>(pending->data.size()),
+                               std::chrono::duration_cast<std::chrono::seconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count(),
+                               false);
+          return WfsResult::Success();
+        }
+      }
+
+      const std::string dir = utils::getDirectory(remotePath);
+      const std::string name = utils::getFileName(remotePath);
+
+      auto lookup = m_listingCache.Find(dir, name, outItem);
+      m_metrics.RecordListingCacheLookup(lookup != DirListingCache::Lookup::Stale);
+      if (lookup != DirListingCache::Lookup::Stale)
+      {
+        WFS_PROBE1(cache__hit, remotePath.size());
+      }
+      else
+      {
+        // Cache miss: refresh the parent listing, sharing any refresh in flight
+        WFS_PROBE1(cache__miss, remotePath.size());
+        auto outcome = m_listFlight.Do(dir, [&]()
+                                       { return ListDirectoryInternal(dir, CallDeadline()); });
+        if (!outcome.result)
+        {
+          return outcome.result;
+        }
+
+        lookup = m_listingCache.Find(dir, name, outItem);
+        if (lookup == DirListingCache::Lookup::Stale && outcome.value)
+        {
+          // Cache disabled or invalidated meanwhile, answer from the fresh listing
+          lookup = DirListingCache::Lookup::Missing;
+          for (const auto &item : outcome.value->items)
+          {
+            if (utils::getFileName(item.name) == name)
+            {
+              outItem = item;
+              lookup = DirListingCache::Lookup::Hit;
+              break;
+            }
+          }
+        }
+      }
+
+      if (lookup == DirListingCache::Lookup::Hit)
+      {
+        return WfsResult::Success();
+      }
+
+      std::lock_guard<std::timed_mutex> lock(m_mutex);
+      m_lastError = WfsResult::Failure(-1, "File not found: " + remotePath);
+      return m_lastError;
+    }
+
+    bool Exists(const std::string &remotePath) override
+    {
+      WfsDirItem item;
+      return Stat(remotePath, item).ok;
+    }
+
+    WfsResult Flush() override
+    {
+      if (!m_writeBehind)
+      {
+        return WfsResult::Success();
+      }
+      return m_writeBehind->Flush();
+    }
+
+    int8_t Ping(const WfsCallOptions &options) override
+    {
+      const CallDeadline call(options);
+      if (m_interceptors.empty())
+      {
+        return DoPing(call);
       }
+      WfsRequest request;
+      request.op = WfsOpType::Ping;
+      request.options = &options;
+      return Intercept(request, [&](WfsResponse &response)
+                       {
+                         response.pingResult = DoPing(call);
+                         response.result = WfsResult(response.pingResult > 0);
+                       })
+          .pingResult;
+    }
+
+    bool IsConnected() const override
+    {
+      std::lock_guard<std::timed_mutex> lock(m_mutex);
+      return m_isConnected;
+    }
+
+    bool IsAuthenticated() const override
+    {
+      std::lock_guard<std::timed_mutex> lock(m_mutex);
+      return m_isAuthenticated;
+    }
+
+    WfsErrorInfo GetLastError() const override
+    {
+      std::lock_guard<std::timed_mutex> lock(m_mutex);
+      return m_lastError.error;
+    }
+
+    WfsMetricsSnapshot GetMetrics() const override
+    {
+      WfsMetricsSnapshot snapshot = m_metrics.Snapshot();
+      snapshot.coalescedReads = m_getFlight.SharedCount() + m_listFlight.SharedCount();
+      snapshot.slowRequestsDropped = m_slowLog.Dropped();
+      if (m_breaker)
+      {
+        m_breaker->Snapshot(snapshot);
+      }
+      snapshot.healthPings = m_healthPings.load(std::memory_order_relaxed);
+      snapshot.healthReconnects = m_healthReconnects.load(std::memory_order_relaxed);
+      snapshot.connectionRttMicros = m_pingRttMicros.load(std::memory_order_relaxed);
+      return snapshot;
+    }
+
+    void SetSlowRequestThreshold(WfsOpType op, int64_t thresholdMicros) override
+    {
+      if (op < WfsOpType::Connect || op >= WfsOpType::Count)
+      {
+        return;
+      }
+      m_slowLog.SetThreshold(op, thresholdMicros);
+    }
+
+    size_t DrainSlowRequests(std::vector<WfsSlowRequest> &outRecords, size_t maxRecords) override
+    {
+      return m_slowLog.Drain(outRecords, maxRecords);
+    }
+
+  private:
+    // Once a write completes (after the client lock is released), detach any
+    // coalesced read of the touched paths so later readers cannot join a
+    // request that was issued before the write
+    class PathMutationGuard
+    {
+    public:
+      PathMutationGuard(WfsClientImpl &client, const std::string &path,
+                        const std::string &otherPath = std::string())
+          : m_owner(client), m_path(path), m_otherPath(otherPath)
+      {
+      }
+
+      ~PathMutationGuard()
+      {
+        m_owner.OnPathMutated(m_path);
+        if (!m_otherPath.empty())
+        {
+          m_owner.OnPathMutated(m_otherPath);
+        }
+      }
+
+    private:
+      WfsClientImpl &m_owner;
+      std::string m_path;
+      std::string m_otherPath;
+    };
+
+    // Hands call to the connection's DeadlineTransport for the scope; taken
+    // under the client lock
+    class ActiveCallScope
+    {
+    public:
+      ActiveCallScope(WfsClientImpl &client, const CallDeadline &call)
+          : m_owner(client)
+      {
+        m_owner.m_activeCall = call;
+      }
+
+      ~ActiveCallScope()
+      {
+        m_owner.m_activeCall = CallDeadline();
+      }
+
+    private:
+      WfsClientImpl &m_owner;
+    };
+
+    // Take the client lock before call has to stop; a call stuck behind a
+    // long operation of another thread gives up at its deadline
+    WfsResult LockForCall(std::unique_lock<std::timed_mutex> &lock, const CallDeadline &call)
+    {
+      if (!call.Bounded())
+      {
+        lock.lock();
+        return WfsResult::Success();
+      }
+      for (;;)
+      {
+        WfsResult status = call.Status();
+        if (!status)
+        {
+          return status;
+        }
+        if (lock.try_lock_for(std::min<CallDeadline::Clock::duration>(call.Remaining(),
+                                                                      CallDeadline::kPollInterval)))
+        {
+          return WfsResult::Success();
+        }
+      }
+    }
 
+    // Circuit breaker gate in front of every server call: fail fast while it
+    // is open; the first call after the open period probes with a Ping
+    WfsResult AdmitCall(const CallDeadline &call)
+    {
+      if (!m_breaker)
+      {
+        return WfsResult::Success();
+      }
+      switch (m_breaker->Admit())
+      {
+      case CircuitBreaker::Admission::Allow:
+        return WfsResult::Success();
+      case CircuitBreaker::Admission::Probe:
+        return ProbeServer(call);
+      default:
+        return WfsResult::Failure(-1, "Circuit breaker open: server marked unavailable",
+                                  WfsErrorCategory::Unavailable);
+      }
+    }
+
+    // Half-open trial Ping on behalf of the breaker
+    WfsResult ProbeServer(const CallDeadline &call)
+    {
+      std::unique_lock<std::timed_mutex> lock(m_mutex, std::defer_lock);
+      WfsResult locked = LockForCall(lock, call);
+      if (!locked)
+      {
+        m_breaker->AbandonProbe();
+        return locked;
+      }
+      ActiveCallScope active(*this, call);
+
+      int8_t pong = -1;
+      const bool ok = EnsureConnected() && PingAttempt(0, pong);
+      if (!ok && !call.Status())
+      {
+        m_breaker->AbandonProbe();
+        return call.Status();
+      }
+      m_breaker->OnProbe(ok);
+      return ok ? WfsResult::Success()
+                : WfsResult::Failure(-1, "Circuit breaker open: trial ping failed", WfsErrorCategory::Unavailable);
+    }
+
+    // Health checker tick: ping the connection once idle for
+    // keepalive.idleInterval, reopen it (restoring the session) when the
+    // Ping fails or the connection was lost. Skipped while a call holds the
+    // client, which means the connection is not idle.
+    void CheckHealth()
+    {
+      std::unique_lock<std::timed_mutex> lock(m_mutex, std::try_to_lock);
+      if (!lock.owns_lock() || !m_wantConnection)
+      {
+        return;
+      }
+      const auto now = std::chrono::steady_clock::now();
+      const bool idle = now - m_lastActivity >= std::chrono::milliseconds(m_params.keepalive.idleInterval);
+      if (m_isConnected && !m_desynced && !idle)
+      {
+        return;
+      }
+
+      // Never hold the client lock for the full receive timeout
+      ActiveCallScope active(*this, CallDeadline(WfsCallOptions(m_params.keepalive.timeout)));
+      if (m_isConnected && !m_desynced)
+      {
+        int8_t pong = -1;
+        m_healthPings.fetch_add(1, std::memory_order_relaxed);
+        if (PingAttempt(0, pong))
+        {
+          m_lastActivity = std::chrono::steady_clock::now();
+          return;
+        }
+        WFS_LOG_WARN("Health check ping failed, reopening the connection");
+      }
+
+      if (ReopenConnection(m_wantSession))
+      {
+        m_healthReconnects.fetch_add(1, std::memory_order_relaxed);
+        WFS_LOG_INFO("Health checker reopened the connection");
+      }
+      m_lastActivity = std::chrono::steady_clock::now();
+    }
+
+    // Smoothed (1/8 gain) round trip of successful Pings
+    void RecordPingRtt(std::chrono::steady_clock::duration rtt)
+    {
+      const int64_t sample = std::chrono::duration_cast<std::chrono::microseconds>(rtt).count();
+      const int64_t smoothed = m_pingRttMicros.load(std::memory_order_relaxed);
+      m_pingRttMicros.store(smoothed == 0 ? std::max<int64_t>(1, sample) : smoothed + (sample - smoothed) / 8,
+                            std::memory_order_relaxed);
+    }
+
+    void OnPathMutated(const std::string &remotePath)
+    {
+      const std::string dir = utils::getDirectory(remotePath);
+      m_getFlight.Forget(remotePath);
+      m_listFlight.Forget(dir);
+      m_listingCache.Invalidate(dir);
+    }
+
+    // Run op through the interceptor chain: OnRequest in order until one
+    // short-circuits, then OnResponse in reverse for those passed through
+    template <typename Invoke>
+    WfsResponse Intercept(const WfsRequest &request, Invoke &&invoke)
+    {
+      WfsResponse response;
+      size_t entered = 0;
       try
       {
-        // Create WfsFile object
-        WfsFile wf;
-        wf.__set_data(fileData.data);
-        wf.__set_name(fileData.name);
-        if (fileData.compress != 0)
+        bool handled = false;
+        for (; entered < m_interceptors.size() && !handled; ++entered)
         {
-          wf.__set_compress(fileData.compress);
+          handled = m_interceptors[entered]->OnRequest(request, response);
         }
+        if (handled)
+        {
+          --entered;
+        }
+        else
+        {
+          invoke(response);
+        }
+        while (entered > 0)
+        {
+          m_interceptors[--entered]->OnResponse(request, response);
+        }
+      }
+      catch (const std::exception &e)
+      {
+        WFS_LOG_ERROR("Interceptor failed: {}", e.what());
+        response.result = WfsResult::Failure(-1, std::string("Interceptor failed: ") + e.what());
+      }
+      catch (...)
+      {
+        WFS_LOG_ERROR("Interceptor failed");
+        response.result = WfsResult::Failure(-1, "Interceptor failed");
+      }
+      return response;
+    }
 
+    // Operations behind the interceptor chain
+    WfsResult DoUploadFile(const WfsFileData &fileData, const CallDeadline &call)
+    {
+      if (m_writeBehind)
+      {
+        // Acknowledge now; the background thread writes it, coalesced with
+        // any later upload of the same path
+        return m_writeBehind->Enqueue(fileData, call);
+      }
+
+      WfsResult admitted = AdmitCall(call);
+      if (!admitted)
+      {
+        return admitted;
+      }
+      PathMutationGuard mutation(*this, fileData.name);
+      std::unique_lock<std::timed_mutex> lock(m_mutex, std::defer_lock);
+      WfsResult locked = LockForCall(lock, call);
+      if (!locked)
+      {
+        return locked;
+      }
+      ActiveCallScope active(*this, call);
+
+      if (ShouldJournal())
+      {
+        return JournalUpload(fileData);
+      }
+
+      if (!EnsureConnectedAndAuthenticated())
+      {
+        return m_lastError;
+      }
+
+      const Idempotency idempotency = m_params.retryPolicy.retryAppend ? Idempotency::Always
+                                                                       : Idempotency::UnlessSent;
+      WfsResult result = Retrying(WfsOpType::Append, idempotency, true, [&](int retries)
+                                  { return UploadAttempt(fileData, retries); });
+      if (!result && m_journal && !m_isConnected)
+      {
+        // Connection lost mid-upload: keep the write for replay
+        return JournalUpload(fileData);
+      }
+      return result;
+    }
+
+    // One Append on the current connection
+    WfsResult UploadAttempt(const WfsFileData &fileData, int retries)
+    {
+      RpcScope rpc(m_metrics, m_slowLog, WfsOpType::Append, fileData.name, m_connectionId,
+                   fileData.data.size());
+      rpc.SetRetries(retries);
+      try
+      {
         // Call Append interface
         WfsAck ack;
-        m_client->Append(ack, wf);
+        rpc.Call(m_phases.get(), [&]()
+                 {
+                   m_client->send_Append(ToWfsFile(fileData));
+                   m_requestSent = true; },
+                 [&]()
+                 { m_client->recv_Append(ack); });
+        m_metrics.AddBytesSent(fileData.data.size());
 
         // Process result
         if (ack.ok)
         {
-          fmt::print(fg(fmt::color::green), "File upload successful: {}\n", fileData.name);
+          rpc.Succeeded();
+          WFS_LOG_DEBUG("File upload successful: {}", fileData.name);
           return WfsResult::Success();
         }
         else
         {
-          fmt::print(fg(fmt::color::red), "File upload failed: {} - {}\n",
-                     ack.error.code, ack.error.info);
+          WFS_LOG_ERROR("File upload failed: {} - {}",
+                        ack.error.code, ack.error.info);
           return CreateErrorResult(ack.error);
         }
       }
@@ -191,188 +806,614 @@ namespace wfs_client
       }
     }
 
-    WfsResult DownloadFile(const std::string &remotePath, std::string &outData) override
+    WfsResult DoDownloadFileShared(const std::string &remotePath,
+                                   std::shared_ptr<const std::string> &outData,
+                                   const CallDeadline &call)
+    {
+      // Read-your-writes for uploads still sitting in the write-behind queue
+      if (m_writeBehind)
+      {
+        if (auto pending = m_writeBehind->Pending(remotePath))
+        {
+          outData = std::shared_ptr<const std::string>(pending, &pending->data);
+          return WfsResult::Success();
+        }
+      }
+
+      // Concurrent downloads of the same path share a single Get
+      auto outcome = m_getFlight.Do(remotePath, [&]()
+                                    { return DownloadFileInternal(remotePath, call); });
+      outData = outcome.value;
+      return outcome.result;
+    }
+
+    WfsResult DoDeleteFile(const std::string &remotePath, const CallDeadline &call)
     {
-      std::lock_guard<std::mutex> lock(m_mutex);
+      // Queued uploads must reach the server before they are deleted/renamed
+      WfsResult flushed = Flush();
+      if (!flushed)
+      {
+        return flushed;
+      }
+
+      WfsResult admitted = AdmitCall(call);
+      if (!admitted)
+      {
+        return admitted;
+      }
+      PathMutationGuard mutation(*this, remotePath);
+      std::unique_lock<std::timed_mutex> lock(m_mutex, std::defer_lock);
+      WfsResult locked = LockForCall(lock, call);
+      if (!locked)
+      {
+        return locked;
+      }
+      ActiveCallScope active(*this, call);
 
       if (!EnsureConnectedAndAuthenticated())
       {
         return m_lastError;
       }
 
+      return Retrying(WfsOpType::Delete, Idempotency::UnlessSent, true, [&](int retries)
+                      { return DeleteAttempt(remotePath, retries); });
+    }
+
+    // One Delete on the current connection
+    WfsResult DeleteAttempt(const std::string &remotePath, int retries)
+    {
+      RpcScope rpc(m_metrics, m_slowLog, WfsOpType::Delete, remotePath, m_connectionId);
+      rpc.SetRetries(retries);
       try
       {
-        // Call Get interface
-        WfsData data;
-        m_client->Get(data, remotePath);
+        // Call Delete interface
+        WfsAck ack;
+        rpc.Call(m_phases.get(), [&]()
+                 {
+                   m_client->send_Delete(remotePath);
+                   m_requestSent = true; },
+                 [&]()
+                 { m_client->recv_Delete(ack); });
 
-        // Check result
-        if (data.__isset.data)
+        // Process result
+        if (ack.ok)
         {
-          outData = data.data;
-          fmt::print(fg(fmt::color::green), "File download successful: {} ({} bytes)\n",
-                     remotePath, outData.size());
+          rpc.Succeeded();
+          WFS_LOG_DEBUG("File deletion successful: {}", remotePath);
           return WfsResult::Success();
         }
         else
         {
-          fmt::print(fg(fmt::color::red), "File download failed: data is empty\n");
-          m_lastError = WfsResult::Failure(-1, "Download failed: no data received");
-          return m_lastError;
+          WFS_LOG_ERROR("File deletion failed: {} - {}",
+                        ack.error.code, ack.error.info);
+          return CreateErrorResult(ack.error);
         }
       }
       catch (const TTransportException &e)
       {
-        HandleTransportException(e, "File download");
+        HandleTransportException(e, "File deletion");
         return m_lastError;
       }
       catch (const TException &e)
       {
-        HandleThriftException(e, "File download");
+        HandleThriftException(e, "File deletion");
         return m_lastError;
       }
       catch (const std::exception &e)
       {
-        HandleStandardException(e, "File download");
+        HandleStandardException(e, "File deletion");
         return m_lastError;
       }
       catch (...)
       {
-        HandleUnknownException("File download");
+        HandleUnknownException("File deletion");
         return m_lastError;
       }
     }
 
-    WfsResult DeleteFile(const std::string &remotePath) override
+    WfsResult DoRenameFile(const std::string &oldPath, const std::string &newPath,
+                           const CallDeadline &call)
     {
-      std::lock_guard<std::mutex> lock(m_mutex);
+      // Queued uploads must reach the server before they are deleted/renamed
+      WfsResult flushed = Flush();
+      if (!flushed)
+      {
+        return flushed;
+      }
+
+      WfsResult admitted = AdmitCall(call);
+      if (!admitted)
+      {
+        return admitted;
+      }
+      PathMutationGuard mutation(*this, oldPath, newPath);
+      std::unique_lock<std::timed_mutex> lock(m_mutex, std::defer_lock);
+      WfsResult locked = LockForCall(lock, call);
+      if (!locked)
+      {
+        return locked;
+      }
+      ActiveCallScope active(*this, call);
 
       if (!EnsureConnectedAndAuthenticated())
       {
         return m_lastError;
       }
 
-      try
+      return Retrying(WfsOpType::Rename, Idempotency::UnlessSent, true, [&](int retries)
+                      { return RenameAttempt(oldPath, newPath, retries); });
+    }
+
+    // One Rename on the current connection
+    WfsResult RenameAttempt(const std::string &oldPath, const std::string &newPath, int retries)
+    {
+      RpcScope rpc(m_metrics, m_slowLog, WfsOpType::Rename, oldPath, m_connectionId);
+      rpc.SetRetries(retries);
+      try
+      {
+        // Call Rename interface
+        WfsAck ack;
+        rpc.Call(m_phases.get(), [&]()
+                 {
+                   m_client->send_Rename(oldPath, newPath);
+                   m_requestSent = true; },
+                 [&]()
+                 { m_client->recv_Rename(ack); });
+
+        // Process result
+        if (ack.ok)
+        {
+          rpc.Succeeded();
+          WFS_LOG_DEBUG("File rename successful: {} -> {}", oldPath, newPath);
+          return WfsResult::Success();
+        }
+        else
+        {
+          WFS_LOG_ERROR("File rename failed: {} - {}",
+                        ack.error.code, ack.error.info);
+          return CreateErrorResult(ack.error);
+        }
+      }
+      catch (const TTransportException &e)
+      {
+        HandleTransportException(e, "File rename");
+        return m_lastError;
+      }
+      catch (const TException &e)
+      {
+        HandleThriftException(e, "File rename");
+        return m_lastError;
+      }
+      catch (const std::exception &e)
+      {
+        HandleStandardException(e, "File rename");
+        return m_lastError;
+      }
+      catch (...)
+      {
+        HandleUnknownException("File rename");
+        return m_lastError;
+      }
+    }
+
+    WfsResult DoListDirectory(const std::string &remotePath,
+                              std::shared_ptr<const WfsDirList> &outDirList,
+                              const CallDeadline &call)
+    {
+      // Concurrent listings of the same directory share a single List
+      auto outcome = m_listFlight.Do(remotePath, [&]()
+                                     { return ListDirectoryInternal(remotePath, call); });
+      outDirList = outcome.value;
+      return outcome.result;
+    }
+
+    int8_t DoPing(const CallDeadline &call)
+    {
+      if (!AdmitCall(call))
+      {
+        return -1;
+      }
+      std::unique_lock<std::timed_mutex> lock(m_mutex, std::defer_lock);
+      if (!LockForCall(lock, call))
+      {
+        return -1;
+      }
+      ActiveCallScope active(*this, call);
+
+      if (!EnsureConnected())
+      {
+        return -1;
+      }
+
+      // A reopened connection gets the session back if there was one
+      int8_t pong = -1;
+      Retrying(WfsOpType::Ping, Idempotency::Always, m_wantSession, [&](int retries)
+               { return PingAttempt(retries, pong); });
+      return pong;
+    }
+
+    // One Ping on the current connection
+    WfsResult PingAttempt(int retries, int8_t &pong)
+    {
+      RpcScope rpc(m_metrics, m_slowLog, WfsOpType::Ping, {}, m_connectionId);
+      rpc.SetRetries(retries);
+      try
+      {
+        const auto start = std::chrono::steady_clock::now();
+        rpc.Call(m_phases.get(), [&]()
+                 { m_client->send_Ping(); },
+                 [&]()
+                 { pong = m_client->recv_Ping(); });
+        rpc.Succeeded();
+        RecordPingRtt(std::chrono::steady_clock::now() - start);
+        WFS_LOG_DEBUG("Ping successful, return value: {}", pong);
+        return WfsResult::Success();
+      }
+      catch (const TTransportException &e)
+      {
+        HandleTransportException(e, "Ping");
+        return m_lastError;
+      }
+      catch (const TException &e)
+      {
+        HandleThriftException(e, "Ping");
+        return m_lastError;
+      }
+      catch (const std::exception &e)
+      {
+        HandleStandardException(e, "Ping");
+        return m_lastError;
+      }
+      catch (...)
+      {
+        HandleUnknownException("Ping");
+        return m_lastError;
+      }
+    }
+
+    // Write a write-behind batch, then invalidate reads of the written paths
+    std::vector<WfsResult> AppendBatch(const WriteBehindQueue::Batch &batch)
+    {
+      std::vector<WfsResult> results;
+      {
+        std::lock_guard<std::timed_mutex> lock(m_mutex);
+        results = AppendBatchInternal(batch);
+      }
+      for (const auto &file : batch)
+      {
+        OnPathMutated(file->name);
+      }
+      return results;
+    }
+
+    // Pipelined Append: every request of the batch is sent before the first
+    // reply is read, so the batch costs a single round trip
+    std::vector<WfsResult> AppendBatchInternal(const WriteBehindQueue::Batch &batch)
+    {
+      std::vector<const WfsFileData *> files;
+      files.reserve(batch.size());
+      for (const auto &file : batch)
+      {
+        files.push_back(file.get());
+      }
+
+      std::vector<WfsResult> results;
+      if (ShouldJournal())
+      {
+        for (const WfsFileData *file : files)
+        {
+          results.push_back(JournalUpload(*file));
+        }
+        return results;
+      }
+
+      if (!EnsureConnectedAndAuthenticated())
+      {
+        results.assign(files.size(), m_lastError);
+        return results;
+      }
+
+      TraceSpan span("wfs.upload_batch");
+      if (span.Active())
+      {
+        uint64_t bytes = 0;
+        for (const WfsFileData *file : files)
+        {
+          bytes += file->data.size();
+        }
+        span.SetBytes(bytes);
+      }
+      const uint64_t started = TscClock::Now();
+      m_lastActivity = std::chrono::steady_clock::now();
+      m_metrics.AddInFlight(static_cast<int64_t>(files.size()));
+      try
+      {
+        PipelinedAppend(*m_client, files, results);
+        RecordBatchAppend(files, results, TscClock::ToNanos(TscClock::Elapsed(started, TscClock::Now())));
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+          if (!results[i])
+          {
+            WFS_LOG_ERROR("File upload failed: {} - {} - {}",
+                          files[i]->name, results[i].error.code, results[i].error.info);
+            m_lastError = results[i];
+          }
+        }
+
+        WFS_LOG_DEBUG("Batch upload completed: {} files", files.size());
+        return results;
+      }
+      catch (const TTransportException &e)
+      {
+        HandleTransportException(e, "Batch upload");
+      }
+      catch (const TException &e)
+      {
+        HandleThriftException(e, "Batch upload");
+      }
+      catch (const std::exception &e)
+      {
+        HandleStandardException(e, "Batch upload");
+      }
+      catch (...)
+      {
+        HandleUnknownException("Batch upload");
+      }
+      RecordBatchAppend(files, results, TscClock::ToNanos(TscClock::Elapsed(started, TscClock::Now())));
+      span.SetOk(false);
+
+      // Replies not received are unknown outcomes: journal them for replay
+      // when possible, otherwise report them as failed
+      for (size_t i = results.size(); i < files.size(); ++i)
+      {
+        results.push_back(m_journal && !m_isConnected ? JournalUpload(*files[i]) : m_lastError);
+      }
+      return results;
+    }
+
+    // Every pipelined Append observed the batch round trip as its latency;
+    // replies never received count as failed calls
+    void RecordBatchAppend(const std::vector<const WfsFileData *> &files,
+                           const std::vector<WfsResult> &results,
+                           uint64_t elapsedNanos)
+    {
+      for (size_t i = 0; i < files.size(); ++i)
       {
-        // Call Delete interface
-        WfsAck ack;
-        m_client->Delete(ack, remotePath);
-
-        // Process result
-        if (ack.ok)
+        const bool replied = i < results.size();
+        if (replied)
         {
-          fmt::print(fg(fmt::color::green), "File deletion successful: {}\n", remotePath);
-          return WfsResult::Success();
-        }
-        else
-        {
-          fmt::print(fg(fmt::color::red), "File deletion failed: {} - {}\n",
-                     ack.error.code, ack.error.info);
-          return CreateErrorResult(ack.error);
+          m_metrics.AddBytesSent(files[i]->data.size());
         }
+        m_metrics.RecordOp(WfsOpType::Append, elapsedNanos, replied && results[i].ok);
       }
-      catch (const TTransportException &e)
+      m_metrics.AddInFlight(-static_cast<int64_t>(files.size()));
+    }
+
+    // Open the offline upload journal configured in the connection parameters
+    void OpenJournal()
+    {
+      UploadJournal::Options options;
+      options.directory = m_params.journalDir;
+      options.segmentBytes = static_cast<uint64_t>(std::max<int64_t>(1, m_params.journalSegmentBytes));
+      options.sync = m_params.journalSync;
+      options.syncInterval = std::chrono::milliseconds(m_params.journalSyncInterval);
+      options.drainConnections = static_cast<size_t>(std::max(1, m_params.journalDrainConnections));
+      options.pipelineDepth = static_cast<size_t>(std::max(1, m_params.journalPipelineDepth));
+      options.retryInterval = std::chrono::milliseconds(m_params.journalRetryInterval);
+
+      auto journal = std::make_unique<UploadJournal>(options, [this]()
+                                                     { return OpenJournalChannel(); });
+      WfsResult opened = journal->Open();
+      if (!opened)
       {
-        HandleTransportException(e, "File deletion");
-        return m_lastError;
+        WFS_LOG_ERROR("Upload journal disabled: {}", opened.error.info);
+        return;
       }
-      catch (const TException &e)
+      m_journal = std::move(journal);
+    }
+
+    // Replay connection for the journal drain thread
+    std::unique_ptr<IJournalChannel> OpenJournalChannel()
+    {
+      WfsConnectionParams params;
+      WfsAuthInfo authInfo;
       {
-        HandleThriftException(e, "File deletion");
-        return m_lastError;
+        std::lock_guard<std::timed_mutex> lock(m_mutex);
+        params = m_params;
+        authInfo = m_authInfo;
       }
-      catch (const std::exception &e)
+
+      auto channel = std::make_unique<SessionJournalChannel>(params, authInfo);
+      if (!channel->Open())
       {
-        HandleStandardException(e, "File deletion");
-        return m_lastError;
+        return nullptr;
       }
-      catch (...)
+      return channel;
+    }
+
+    // Uploads go to the journal while a connection or session the caller
+    // had is lost and while older journaled records are still waiting, so
+    // none is overtaken. Never signed in: fail as without a journal.
+    bool ShouldJournal() const
+    {
+      return m_journal && ((m_wantConnection && !m_isConnected) || (m_wantSession && !m_isAuthenticated) ||
+                           m_journal->HasPending());
+    }
+
+    WfsResult JournalUpload(const WfsFileData &fileData)
+    {
+      WfsResult journaled = m_journal->Append(fileData);
+      if (!journaled)
       {
-        HandleUnknownException("File deletion");
+        m_lastError = journaled;
         return m_lastError;
       }
+      WFS_LOG_INFO("File upload journaled for replay: {}", fileData.name);
+      return WfsResult::Success();
     }
 
-    WfsResult RenameFile(const std::string &oldPath, const std::string &newPath) override
+    // Single Get round trip, executed by the leader of a coalesced download
+    SingleFlight<std::string>::Outcome DownloadFileInternal(const std::string &remotePath,
+                                                            const CallDeadline &call)
     {
-      std::lock_guard<std::mutex> lock(m_mutex);
+      SingleFlight<std::string>::Outcome outcome;
+      outcome.result = AdmitCall(call);
+      if (!outcome.result)
+      {
+        return outcome;
+      }
+      std::unique_lock<std::timed_mutex> lock(m_mutex, std::defer_lock);
+      outcome.result = LockForCall(lock, call);
+      if (!outcome.result)
+      {
+        return outcome;
+      }
+      ActiveCallScope active(*this, call);
 
       if (!EnsureConnectedAndAuthenticated())
       {
-        return m_lastError;
+        outcome.result = m_lastError;
+        return outcome;
       }
 
+      outcome.result = Retrying(WfsOpType::Get, Idempotency::Always, true, [&](int retries)
+                                {
+                                  outcome = DownloadAttempt(remotePath, retries);
+                                  return outcome.result; });
+      return outcome;
+    }
+
+    // One Get on the current connection
+    SingleFlight<std::string>::Outcome DownloadAttempt(const std::string &remotePath, int retries)
+    {
+      SingleFlight<std::string>::Outcome outcome;
+      RpcScope rpc(m_metrics, m_slowLog, WfsOpType::Get, remotePath, m_connectionId);
+      rpc.SetRetries(retries);
       try
       {
-        // Call Rename interface
-        WfsAck ack;
-        m_client->Rename(ack, oldPath, newPath);
+        // Call Get interface
+        WfsData data;
+        rpc.Call(m_phases.get(), [&]()
+                 { m_client->send_Get(remotePath); },
+                 [&]()
+                 { m_client->recv_Get(data); });
 
-        // Process result
-        if (ack.ok)
+        // Check result
+        if (data.__isset.data)
         {
-          fmt::print(fg(fmt::color::green), "File rename successful: {} -> {}\n", oldPath, newPath);
-          return WfsResult::Success();
+          rpc.Succeeded();
+          rpc.SetBytes(data.data.size());
+          m_metrics.AddBytesReceived(data.data.size());
+          auto buffer = std::make_shared<std::string>(std::move(data.data));
+          WFS_LOG_DEBUG("File download successful: {} ({} bytes)",
+                        remotePath, buffer->size());
+          outcome.result = WfsResult::Success();
+          outcome.value = std::move(buffer);
+          return outcome;
         }
         else
         {
-          fmt::print(fg(fmt::color::red), "File rename failed: {} - {}\n",
-                     ack.error.code, ack.error.info);
-          return CreateErrorResult(ack.error);
+          WFS_LOG_ERROR("File download failed: data is empty");
+          m_lastError = WfsResult::Failure(-1, "Download failed: no data received");
+          outcome.result = m_lastError;
+          return outcome;
         }
       }
       catch (const TTransportException &e)
       {
-        HandleTransportException(e, "File rename");
-        return m_lastError;
+        HandleTransportException(e, "File download");
+        outcome.result = m_lastError;
+        return outcome;
       }
       catch (const TException &e)
       {
-        HandleThriftException(e, "File rename");
-        return m_lastError;
+        HandleThriftException(e, "File download");
+        outcome.result = m_lastError;
+        return outcome;
       }
       catch (const std::exception &e)
       {
-        HandleStandardException(e, "File rename");
-        return m_lastError;
+        HandleStandardException(e, "File download");
+        outcome.result = m_lastError;
+        return outcome;
       }
       catch (...)
       {
-        HandleUnknownException("File rename");
-        return m_lastError;
+        HandleUnknownException("File download");
+        outcome.result = m_lastError;
+        return outcome;
       }
     }
 
-    WfsResult ListDirectory(const std::string &remotePath, WfsDirList &outDirList) override
+    // Single List round trip, executed by the leader of a coalesced listing
+    SingleFlight<WfsDirList>::Outcome ListDirectoryInternal(const std::string &remotePath,
+                                                            const CallDeadline &call)
     {
-      std::lock_guard<std::mutex> lock(m_mutex);
+      // Capture before the RPC so a listing racing with a write is not cached
+      const uint64_t cacheGeneration = m_listingCache.Generation();
+
+      SingleFlight<WfsDirList>::Outcome outcome;
+      outcome.result = AdmitCall(call);
+      if (!outcome.result)
+      {
+        return outcome;
+      }
+      std::unique_lock<std::timed_mutex> lock(m_mutex, std::defer_lock);
+      outcome.result = LockForCall(lock, call);
+      if (!outcome.result)
+      {
+        return outcome;
+      }
+      ActiveCallScope active(*this, call);
 
       if (!EnsureConnectedAndAuthenticated())
       {
-        return m_lastError;
+        outcome.result = m_lastError;
+        return outcome;
       }
 
+      outcome.result = Retrying(WfsOpType::List, Idempotency::Always, true, [&](int retries)
+                                {
+                                  outcome = ListAttempt(remotePath, cacheGeneration, retries);
+                                  return outcome.result; });
+      return outcome;
+    }
+
+    // One List on the current connection
+    SingleFlight<WfsDirList>::Outcome ListAttempt(const std::string &remotePath, uint64_t cacheGeneration,
+                                                  int retries)
+    {
+      SingleFlight<WfsDirList>::Outcome outcome;
+      RpcScope rpc(m_metrics, m_slowLog, WfsOpType::List, remotePath, m_connectionId);
+      rpc.SetRetries(retries);
       try
       {
         // Call List interface
         DirList dirList;
-        m_client->List(dirList, remotePath);
+        rpc.Call(m_phases.get(), [&]()
+                 { m_client->send_List(remotePath); },
+                 [&]()
+                 { m_client->recv_List(dirList); });
 
         // Process results and convert to local structure
-        outDirList.path = dirList.path;
+        auto outDirList = std::make_shared<WfsDirList>();
+        outDirList->path = dirList.path;
 
         if (dirList.__isset.error && dirList.error.__isset.code)
         {
-          outDirList.error.code = dirList.error.code;
-          outDirList.error.info = dirList.error.info;
-
-          fmt::print(fg(fmt::color::red), "Directory listing failed: {} - {}\n",
-                     dirList.error.code, dirList.error.info);
-          return CreateErrorResult(dirList.error);
+          outDirList->error.code = dirList.error.code;
+          outDirList->error.info = dirList.error.info;
+          outDirList->error.category = WfsErrorCategory::Server;
+
+          WFS_LOG_ERROR("Directory listing failed: {} - {}",
+                        dirList.error.code, dirList.error.info);
+          outcome.result = CreateErrorResult(dirList.error);
+          outcome.value = std::move(outDirList);
+          return outcome;
         }
 
         // Convert directory items
-        outDirList.items.clear();
+        outDirList->items.reserve(dirList.items.size());
         for (const auto &item : dirList.items)
         {
           WfsDirItem dirItem;
@@ -380,118 +1421,74 @@ namespace wfs_client
           dirItem.size = item.size;
           dirItem.mtime = item.mtime;
           dirItem.isDir = item.isDir;
-          outDirList.items.push_back(dirItem);
+          outDirList->items.push_back(std::move(dirItem));
         }
 
-        fmt::print(fg(fmt::color::green), "Directory listing successful: {} (total {} items)\n",
-                   remotePath, outDirList.items.size());
-        return WfsResult::Success();
+        WFS_LOG_DEBUG("Directory listing successful: {} (total {} items)",
+                      remotePath, outDirList->items.size());
+        m_listingCache.Store(remotePath, *outDirList, cacheGeneration);
+        rpc.Succeeded();
+        outcome.result = WfsResult::Success();
+        outcome.value = std::move(outDirList);
+        return outcome;
       }
       catch (const TTransportException &e)
       {
         HandleTransportException(e, "List directory");
-        return m_lastError;
+        outcome.result = m_lastError;
+        return outcome;
       }
       catch (const TException &e)
       {
         HandleThriftException(e, "List directory");
-        return m_lastError;
+        outcome.result = m_lastError;
+        return outcome;
       }
       catch (const std::exception &e)
       {
         HandleStandardException(e, "List directory");
-        return m_lastError;
+        outcome.result = m_lastError;
+        return outcome;
       }
       catch (...)
       {
         HandleUnknownException("List directory");
-        return m_lastError;
-      }
-    }
-
-    int8_t Ping() override
-    {
-      std::lock_guard<std::mutex> lock(m_mutex);
-
-      if (!EnsureConnected())
-      {
-        return -1;
-      }
-
-      try
-      {
-        int8_t result = m_client->Ping();
-        fmt::print(fg(fmt::color::green), "Ping successful, return value: {}\n", result);
-        return result;
-      }
-      catch (const TTransportException &e)
-      {
-        HandleTransportException(e, "Ping");
-        return -1;
-      }
-      catch (const TException &e)
-      {
-        HandleThriftException(e, "Ping");
-        return -1;
-      }
-      catch (const std::exception &e)
-      {
-        HandleStandardException(e, "Ping");
-        return -1;
-      }
-      catch (...)
-      {
-        HandleUnknownException("Ping");
-        return -1;
+        outcome.result = m_lastError;
+        return outcome;
       }
     }
 
-    bool IsConnected() const override
-    {
-      std::lock_guard<std::mutex> lock(m_mutex);
-      return m_isConnected;
-    }
-
-    bool IsAuthenticated() const override
-    {
-      std::lock_guard<std::mutex> lock(m_mutex);
-      return m_isAuthenticated;
-    }
-
-    WfsErrorInfo GetLastError() const override
-    {
-      std::lock_guard<std::mutex> lock(m_mutex);
-      return m_lastError.error;
-    }
-
-  private:
     // Internal connection method
     WfsResult ConnectInternal()
     {
+      RpcScope rpc(m_metrics, m_slowLog, WfsOpType::Connect, {}, m_connectionId);
       try
       {
-        fmt::print("Connecting to server: {}:{}\n", m_params.serverIp, m_params.serverPort);
-
-        // Create socket
-        m_socket.reset(new TSocket(m_params.serverIp, m_params.serverPort));
+        WFS_LOG_INFO("Connecting to server: {}:{}", m_params.serverIp, m_params.serverPort);
 
-        // Set timeout parameters
-        m_socket->setConnTimeout(m_params.connectTimeout);
-        m_socket->setRecvTimeout(m_params.receiveTimeout);
-        m_socket->setSendTimeout(m_params.sendTimeout);
-
-        // Create transport layer and protocol
-        m_transport.reset(new TBufferedTransport(m_socket, 8192));
-        m_protocol.reset(new TCompactProtocol(m_transport));
-
-        // Create client
-        m_client.reset(new WfsIfaceClient(m_protocol));
+        // Create socket, transport layer, protocol and client
+        WfsTransportStack stack = CreateTransportStack(m_params, &m_activeCall, m_rtt.get());
+        m_socket = stack.socket;
+        m_phases = stack.phases;
+        m_transport = stack.transport;
+        m_protocol = stack.protocol;
+        m_client = stack.client;
 
         // Open connection
-        fmt::print(fg(fmt::color::yellow), "Connecting to server...\n");
+        WFS_LOG_DEBUG("Connecting to server...");
         m_transport->open();
-        m_isConnected = true;
-        fmt::print(fg(fmt::color::green), "Connected to server successfully\n");
+        SetConnected(true);
+        m_desynced = false;
+        m_lastActivity = std::chrono::steady_clock::now();
+        ++m_connectionId;
+        if (m_hasConnected)
+        {
+          m_metrics.AddReconnect();
+          WFS_PROBE1(reconnect, m_connectionId);
+        }
+        m_hasConnected = true;
+        rpc.Succeeded();
+        WFS_LOG_INFO("Connected to server successfully");
 
         return WfsResult::Success();
       }
@@ -522,12 +1519,20 @@ namespace wfs_client
     {
       if (!m_isConnected)
       {
-        m_lastError = WfsResult::Failure(-1, "Not connected to server");
+        m_lastError = WfsResult::Failure(-1, "Not connected to server", WfsErrorCategory::Unavailable);
         return m_lastError;
       }
 
-      fmt::print(fg(fmt::color::yellow), "Authenticating (username: {})...\n", m_authInfo.username);
+      WFS_LOG_DEBUG("Authenticating (username: {})...", m_authInfo.username);
+      return Retrying(WfsOpType::Auth, Idempotency::Always, false, [&](int retries)
+                      { return AuthenticateAttempt(retries); });
+    }
 
+    // One Auth on the current connection
+    WfsResult AuthenticateAttempt(int retries)
+    {
+      RpcScope rpc(m_metrics, m_slowLog, WfsOpType::Auth, {}, m_connectionId);
+      rpc.SetRetries(retries);
       try
       {
         // Create authentication request
@@ -536,69 +1541,38 @@ namespace wfs_client
         auth.__set_pwd(m_authInfo.password);
 
         // Send authentication request
-        fmt::print("Sending authentication request...\n");
+        WFS_LOG_DEBUG("Sending authentication request...");
         WfsAck authResult;
+        rpc.Call(m_phases.get(), [&]()
+                 { m_client->send_Auth(auth); },
+                 [&]()
+                 { m_client->recv_Auth(authResult); });
 
-        // Add retry logic
-        for (int retry = 1; retry <= m_params.maxRetries; retry++)
+        // Check authentication result
+        if (authResult.ok)
         {
-          try
-          {
-            m_client->Auth(authResult, auth);
-
-            // Check authentication result
-            if (authResult.ok)
-            {
-              fmt::print(fg(fmt::color::green), "Authentication successful\n");
-              m_isAuthenticated = true;
-              return WfsResult::Success();
-            }
-            else
-            {
-              fmt::print(fg(fmt::color::red), "Authentication failed: {} - {}\n",
-                         authResult.error.code, authResult.error.info);
-              m_isAuthenticated = false;
-              return CreateErrorResult(authResult.error);
-            }
-          }
-          catch (const TTransportException &e)
+          rpc.Succeeded();
+          WFS_LOG_INFO("Authentication successful");
+          m_isAuthenticated = true;
+          m_wantSession = true;
+          if (m_journal)
           {
-            fmt::print(fg(fmt::color::yellow),
-                       "Authentication attempt {}/{} failed: {}\nError type: {}\n",
-                       retry, m_params.maxRetries, e.what(),
-                       getExceptionTypeStr(e.getType()));
-
-            if (retry < m_params.maxRetries)
-            {
-              fmt::print("Waiting 3 seconds before retry...\n");
-              std::this_thread::sleep_for(std::chrono::seconds(3));
-
-              // Try to reconnect
-              try
-              {
-                fmt::print("Attempting to reconnect...\n");
-                m_client->getInputProtocol()->getTransport()->close();
-                m_client->getInputProtocol()->getTransport()->open();
-                fmt::print(fg(fmt::color::green), "Reconnection successful\n");
-              }
-              catch (const TTransportException &recon_e)
-              {
-                fmt::print(fg(fmt::color::red), "Reconnection failed: {}\n", recon_e.what());
-                m_isConnected = false;
-              }
-            }
-            else
-            {
-              fmt::print(fg(fmt::color::red), "Authentication failed, maximum retries reached\n");
-              m_isAuthenticated = false;
-              m_lastError = WfsResult::Failure(-1, std::string("Authentication exception: ") + e.what());
-              return m_lastError;
-            }
+            m_journal->Wake();
           }
+          return WfsResult::Success();
         }
-
+        else
+        {
+          WFS_LOG_ERROR("Authentication failed: {} - {}",
+                        authResult.error.code, authResult.error.info);
+          m_isAuthenticated = false;
+          return CreateErrorResult(authResult.error);
+        }
+      }
+      catch (const TTransportException &e)
+      {
+        HandleTransportException(e, "Authentication");
         m_isAuthenticated = false;
-        m_lastError = WfsResult::Failure(-1, "Authentication failed, retry limit reached");
         return m_lastError;
       }
       catch (const TException &e)
@@ -621,13 +1595,131 @@ namespace wfs_client
       }
     }
 
+    // Whether an operation may be sent again after a transport failure
+    enum class Idempotency
+    {
+      Always,    // reads, and writes the caller declared safe to repeat
+      UnlessSent // only if the request never fully left the client
+    };
+
+    // Run attempt(retries) until it succeeds, fails for a reason other than
+    // the transport, or the retry policy gives up, and feed the outcome to
+    // the circuit breaker
+    template <typename Attempt>
+    WfsResult Retrying(WfsOpType op, Idempotency idempotency, bool authenticate, Attempt &&attempt)
+    {
+      WfsResult result = RetryAttempts(op, idempotency, authenticate, std::forward<Attempt>(attempt));
+      m_lastActivity = std::chrono::steady_clock::now();
+      if (m_breaker && !m_activeCall.Cancelled() && (result || !m_activeCall.Expired()))
+      {
+        // Server-side errors come from a live server; only transport failures
+        // count, and not those cut short by the caller's own deadline
+        m_breaker->Record(result || !m_transientFailure);
+      }
+      return result;
+    }
+
+    // The connection is reopened (and re-authenticated when authenticate is
+    // set) between attempts. The active call's deadline/token ends the loop
+    // early.
+    template <typename Attempt>
+    WfsResult RetryAttempts(WfsOpType op, Idempotency idempotency, bool authenticate, Attempt &&attempt)
+    {
+      RetryBackoff backoff(m_params.retryPolicy, m_params.maxRetries);
+      for (;;)
+      {
+        m_transientFailure = false;
+        m_requestSent = false;
+        WfsResult result = attempt(backoff.Retries());
+        if (!result && !m_activeCall.Status())
+        {
+          // Deadline or cancellation
+          m_lastError = m_activeCall.Status();
+          return m_lastError;
+        }
+        if (result || !m_transientFailure ||
+            (idempotency == Idempotency::UnlessSent && m_requestSent))
+        {
+          return result;
+        }
+
+        // Failed reconnects use up attempts too
+        for (;;)
+        {
+          auto wait = backoff.Next();
+          if (!wait)
+          {
+            WFS_LOG_ERROR("{} failed after {} attempt(s)", WfsOpTypeName(op), backoff.Retries());
+            return m_lastError;
+          }
+          WFS_LOG_WARN("{} failed, attempt {}/{} in {} ms", WfsOpTypeName(op), backoff.Retries() + 1,
+                       backoff.MaxAttempts(), wait->count());
+          WFS_PROBE2(retry, static_cast<int>(op), backoff.Retries());
+          if (!m_activeCall.SleepFor(*wait))
+          {
+            m_lastError = m_activeCall.Status();
+            return m_lastError;
+          }
+          if (ReopenConnection(authenticate))
+          {
+            break;
+          }
+        }
+      }
+    }
+
+    // Replace the current connection, whose buffers may hold half a message
+    bool ReopenConnection(bool authenticate)
+    {
+      if (m_transport)
+      {
+        try
+        {
+          m_transport->close();
+        }
+        catch (...)
+        {
+        }
+      }
+      SetConnected(false);
+      m_isAuthenticated = false;
+
+      if (!ConnectInternal())
+      {
+        return false;
+      }
+      return !authenticate || AuthenticateAttempt(0);
+    }
+
+    // Track connection state changes in the open connections gauge
+    void SetConnected(bool connected)
+    {
+      if (m_isConnected != connected)
+      {
+        m_isConnected = connected;
+        m_metrics.AddOpenConnections(connected ? 1 : -1);
+      }
+    }
+
     // Ensure connection status
     bool EnsureConnected()
     {
+      if (!m_isConnected && m_wantConnection)
+      {
+        // Lost since the last call: reconnect transparently, restoring the session
+        WFS_LOG_INFO("Connection lost, reconnecting");
+        ReopenConnection(m_wantSession);
+      }
+      else if (m_isConnected && m_desynced)
+      {
+        // A cut short exchange may have left bytes on the wire
+        WFS_LOG_DEBUG("Reopening connection after an aborted call");
+        ReopenConnection(m_wantSession || m_isAuthenticated);
+      }
       if (!m_isConnected)
       {
-        fmt::print(fg(fmt::color::red), "Operation failed: Not connected to server\n");
-        m_lastError = WfsResult::Failure(-1, "Not connected to server");
+        WFS_LOG_ERROR("Operation failed: Not connected to server");
+        m_lastError = WfsResult::Failure(-1, "Not connected to server", WfsErrorCategory::Unavailable);
         return false;
       }
       return true;
@@ -641,9 +1733,14 @@ namespace wfs_client
         return false;
       }
 
+      if (!m_isAuthenticated && m_wantSession)
+      {
+        // Session lost with the connection (or refused meanwhile): log in again
+        AuthenticateAttempt(0);
+      }
       if (!m_isAuthenticated)
       {
-        fmt::print(fg(fmt::color::red), "Operation failed: Not authenticated\n");
+        WFS_LOG_ERROR("Operation failed: Not authenticated");
         m_lastError = WfsResult::Failure(-1, "Not authenticated");
         return false;
       }
@@ -653,57 +1750,127 @@ namespace wfs_client
     // Create error result from Thrift error
     WfsResult CreateErrorResult(const WfsError &error)
     {
-      m_lastError = WfsResult::Failure(error.code, error.info);
+      m_lastError = WfsResult::Failure(error.code, error.info, WfsErrorCategory::Server);
       return m_lastError;
     }
 
     // Exception handling methods
     void HandleTransportException(const TTransportException &e, const std::string &operation)
     {
-      fmt::print(fg(fmt::color::red), "Transport exception during {}: {}\nError type: {}\n",
-                 operation, e.what(), getExceptionTypeStr(e.getType()));
-      m_lastError = WfsResult::Failure(-1, std::string("Transport exception: ") + e.what());
+      m_metrics.RecordTransportError(e.getType());
+      WFS_LOG_ERROR("Transport exception during {}: {} - Error type: {}",
+                    operation, e.what(), getExceptionTypeStr(e.getType()));
+      // Check() aborts the exchange with a transport exception when the
+      // caller's own deadline or token ends the call
+      const WfsErrorCategory category = m_activeCall.Cancelled() ? WfsErrorCategory::Cancelled
+                                        : m_activeCall.Expired() ? WfsErrorCategory::DeadlineExceeded
+                                                                 : WfsErrorCategory::Transport;
+      m_lastError = WfsResult::Failure(-1, std::string("Transport exception: ") + e.what(), category);
+      m_transientFailure = true;
 
       // Connection may be broken
       if (e.getType() == TTransportException::NOT_OPEN ||
           e.getType() == TTransportException::END_OF_FILE)
       {
-        m_isConnected = false;
+        SetConnected(false);
         m_isAuthenticated = false;
       }
+      else
+      {
+        // Still open, but a timed out or aborted exchange may have left
+        // part of a request or reply on the wire
+        m_desynced = true;
+      }
     }
 
     void HandleThriftException(const TException &e, const std::string &operation)
     {
-      fmt::print(fg(fmt::color::red), "Thrift exception during {}: {}\n", operation, e.what());
+      WFS_LOG_ERROR("Thrift exception during {}: {}", operation, e.what());
       m_lastError = WfsResult::Failure(-1, std::string("Thrift exception: ") + e.what());
+      if (dynamic_cast<const apache::thrift::protocol::TProtocolException *>(&e))
+      {
+        // A garbled frame: the rest of the reply is still on the wire
+        m_lastError.error.category = WfsErrorCategory::Transport;
+        m_transientFailure = true;
+        m_desynced = true;
+      }
     }
 
     void HandleStandardException(const std::exception &e, const std::string &operation)
     {
-      fmt::print(fg(fmt::color::red), "Standard exception during {}: {}\n", operation, e.what());
+      WFS_LOG_ERROR("Standard exception during {}: {}", operation, e.what());
       m_lastError = WfsResult::Failure(-1, std::string("Standard exception: ") + e.what());
     }
 
     void HandleUnknownException(const std::string &operation)
     {
-      fmt::print(fg(fmt::color::red), "Unknown exception during {}\n", operation);
+      WFS_LOG_ERROR("Unknown exception during {}", operation);
       m_lastError = WfsResult::Failure(-1, "Unknown exception");
     }
 
   private:
-    mutable std::mutex m_mutex;
+    mutable std::timed_mutex m_mutex;
     bool m_isConnected;
     bool m_isAuthenticated;
+    bool m_hasConnected{false};
+    bool m_transientFailure{false}; // last attempt failed in the transport
+    bool m_requestSent{false};      // last attempt's request fully written
+    bool m_desynced{false};         // an exchange was cut short, reopen before the next one
+
+    // Deadline/token of the call holding the lock, checked by the transport
+    CallDeadline m_activeCall;
+
+    // Optional reply wait estimator (WfsConnectionParams::adaptiveTimeout),
+    // kept across reconnects
+    std::unique_ptr<RttEstimator> m_rtt;
+
+    // Optional fail-fast gate (WfsConnectionParams::circuitBreaker)
+    std::unique_ptr<CircuitBreaker> m_breaker;
+
+    // What the caller asked for, restored by the health checker
+    bool m_wantConnection{false}; // connected and not disconnected since
+    bool m_wantSession{false};    // authenticated and not disconnected since
+    std::chrono::steady_clock::time_point m_lastActivity;
+
+    // Health checking (WfsConnectionParams::keepalive)
+    std::atomic<uint64_t> m_healthPings{0};
+    std::atomic<uint64_t> m_healthReconnects{0};
+    std::atomic<int64_t> m_pingRttMicros{0};
+    std::unique_ptr<HealthChecker> m_healthChecker;
     WfsConnectionParams m_params;
     WfsAuthInfo m_authInfo;
     WfsResult m_lastError;
 
     // Thrift client related objects
     std::shared_ptr<TSocket> m_socket;
+    std::shared_ptr<PhaseTransport> m_phases;
     std::shared_ptr<TTransport> m_transport;
     std::shared_ptr<TProtocol> m_protocol;
     std::shared_ptr<WfsIfaceClient> m_client;
+
+    // Coalescing of concurrent identical reads
+    SingleFlight<std::string> m_getFlight;
+    SingleFlight<WfsDirList> m_listFlight;
+
+    // Hash-indexed parent listings backing Stat/Exists
+    DirListingCache m_listingCache;
+
+    // Optional asynchronous upload queue (WfsConnectionParams::writeBehind)
+    std::unique_ptr<WriteBehindQueue> m_writeBehind;
+
+    // Optional durable offline upload journal (WfsConnectionParams::journalDir)
+    std::unique_ptr<UploadJournal> m_journal;
+
+    // Composed at creation, read-only afterwards
+    const std::vector<std::shared_ptr<IWfsInterceptor>> m_interceptors;
+
+    // Per-RPC latency histograms and counters (GetMetrics)
+    WfsMetricsRecorder m_metrics;
+
+    // RPCs over their per-type threshold (DrainSlowRequests)
+    static constexpr size_t kSlowRequestLogCapacity = 1024;
+    SlowRequestLog m_slowLog{kSlowRequestLogCapacity};
+    uint64_t m_connectionId{0};
   };
 
   bool CreateWfsClient(
@@ -711,14 +1878,60 @@ namespace wfs_client
       const WfsConnectionParams &params,
       const WfsAuthInfo &authInfo)
   {
-    client = std::make_shared<WfsClientImpl>();
+    return CreateWfsClientWithInterceptors(client, params, authInfo, {});
+  }
+
+  // Interceptors without the null entries
+  static std::vector<std::shared_ptr<IWfsInterceptor>> InterceptorChain(
+      const std::vector<std::shared_ptr<IWfsInterceptor>> &interceptors)
+  {
+    std::vector<std::shared_ptr<IWfsInterceptor>> chain;
+    for (const auto &interceptor : interceptors)
+    {
+      if (interceptor)
+      {
+        chain.push_back(interceptor);
+      }
+    }
+    return chain;
+  }
+
+  bool CreateWfsClientWithInterceptors(
+      std::shared_ptr<IWfsClient> &client,
+      const WfsConnectionParams &params,
+      const WfsAuthInfo &authInfo,
+      const std::vector<std::shared_ptr<IWfsInterceptor>> &interceptors)
+  {
+    if (!params.sharding.nodes.empty())
+    {
+      std::shared_ptr<IWfsShardedClient> sharded;
+      const bool created = CreateWfsShardedClient(sharded, params, authInfo, interceptors);
+      client = sharded;
+      return created;
+    }
+
+    std::vector<std::shared_ptr<IWfsInterceptor>> chain = InterceptorChain(interceptors);
+    if (!params.endpoints.empty())
+    {
+      // One client per endpoint, the balancer routing between them
+      std::vector<std::shared_ptr<IWfsClient>> clients;
+      for (size_t i = 0; i < params.endpoints.size(); ++i)
+      {
+        clients.push_back(std::make_shared<WfsClientImpl>(chain));
+      }
+      client = std::make_shared<BalancedClient>(std::move(clients), params.endpoints);
+    }
+    else
+    {
+      client = std::make_shared<WfsClientImpl>(std::move(chain));
+    }
     if (client)
     {
-      fmt::print(fg(fmt::color::green), "Client creation successful\n");
+      WFS_LOG_DEBUG("Client creation successful");
     }
     else
     {
-      fmt::print(fg(fmt::color::red), "Client creation failed\n");
+      WFS_LOG_ERROR("Client creation failed");
       return false;
     }
 
@@ -729,4 +1942,26 @@ namespace wfs_client
     return wres;
   }
 
+  bool CreateWfsShardedClient(
+      std::shared_ptr<IWfsShardedClient> &client,
+      const WfsConnectionParams &params,
+      const WfsAuthInfo &authInfo,
+      const std::vector<std::shared_ptr<IWfsInterceptor>> &interceptors)
+  {
+    client = std::make_shared<ShardedClient>(
+        [chain = InterceptorChain(interceptors)]()
+        { return std::make_shared<WfsClientImpl>(chain); });
+
+    WfsResult wres = client->Connect(params);
+    if (!wres)
+      return false;
+    wres = client->Authenticate(authInfo);
+    return wres;
+  }
+
+  void CreateWfsFaultInjector(std::shared_ptr<IWfsFaultInjector> &injector)
+  {
+    injector = std::make_shared<FaultInjector>();
+  }
+
 } // namespace wfs_client
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "wfs_log.hpp"
+
+#include <fmt/color.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wfs_client
+{
+
+  namespace
+  {
+
+    // Colored stdout logger, the default sink
+    class ConsoleLogger : public IWfsLogger
+    {
+    public:
+      void Log(WfsLogLevel level, std::string_view message) override
+      {
+        switch (level)
+        {
+        case WfsLogLevel::Error:
+          fmt::print(fg(fmt::color::red), "{}\n", message);
+          break;
+        case WfsLogLevel::Warn:
+          fmt::print(fg(fmt::color::yellow), "{}\n", message);
+          break;
+        case WfsLogLevel::Info:
+          fmt::print(fg(fmt::color::green), "{}\n", message);
+          break;
+        default:
+          fmt::print("{}\n", message);
+          break;
+        }
+      }
+
+      void Flush() override
+      {
+        fflush(stdout);
+      }
+    };
+
+    // Asynchronous logger over a bounded lock-free MPSC ring (Vyukov-style
+    // sequence numbers). Slots keep their string capacity, so once warmed up
+    // a producer only copies bytes and never allocates or blocks.
+    class AsyncRingLogger : public IWfsLogger
+    {
+    public:
+      AsyncRingLogger(std::shared_ptr<IWfsLogger> sink, size_t capacity)
+          : m_sink(std::move(sink))
+      {
+        size_t size = 2;
+        while (size < capacity)
+        {
+          size <<= 1;
+        }
+        m_mask = size - 1;
+        m_slots = std::make_unique<Slot[]>(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+          m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_consumer = std::thread([this]()
+                                 { Run(); });
+      }
+
+      ~AsyncRingLogger() override
+      {
+        m_stopping.store(true, std::memory_order_release);
+        if (m_consumer.joinable())
+        {
+          m_consumer.join();
+        }
+      }
+
+      void Log(WfsLogLevel level, std::string_view message) override
+      {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+          Slot &slot = m_slots[pos & m_mask];
+          const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+          const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+          if (diff == 0)
+          {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+              slot.level = level;
+              slot.message.assign(message.data(), message.size());
+              slot.sequence.store(pos + 1, std::memory_order_release);
+              return;
+            }
+          }
+          else if (diff < 0)
+          {
+            // Ring full: drop rather than block the caller
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+          }
+          else
+          {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+          }
+        }
+      }
+
+      void Flush() override
+      {
+        const size_t target = m_enqueuePos.load(std::memory_order_acquire);
+        while (m_dequeuePos.load(std::memory_order_acquire) < target &&
+               !m_stopping.load(std::memory_order_acquire))
+        {
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        if (m_sink)
+        {
+          m_sink->Flush();
+        }
+      }
+
+    private:
+      struct alignas(64) Slot
+      {
+        std::atomic<size_t> sequence{0};
+        WfsLogLevel level{WfsLogLevel::Info};
+        std::string message;
+      };
+
+      bool Drain(std::string &buffer)
+      {
+        bool any = false;
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+          Slot &slot = m_slots[pos & m_mask];
+          if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+          {
+            break;
+          }
+          const WfsLogLevel level = slot.level;
+          buffer.assign(slot.message);
+          slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+          m_dequeuePos.store(++pos, std::memory_order_release);
+          any = true;
+
+          if (m_sink)
+          {
+            m_sink->Log(level, buffer);
+          }
+        }
+
+        const uint64_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0 && m_sink)
+        {
+          m_sink->Log(WfsLogLevel::Warn, fmt::format("{} log messages dropped, ring buffer full", dropped));
+        }
+        return any;
+      }
+
+      void Run()
+      {
+        std::string buffer;
+        while (!m_stopping.load(std::memory_order_acquire))
+        {
+          if (!Drain(buffer))
+          {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          }
+        }
+        Drain(buffer);
+        if (m_sink)
+        {
+          m_sink->Flush();
+        }
+      }
+
+      std::shared_ptr<IWfsLogger> m_sink;
+      std::unique_ptr<Slot[]> m_slots;
+      size_t m_mask{0};
+      alignas(64) std::atomic<size_t> m_enqueuePos{0};
+      alignas(64) std::atomic<size_t> m_dequeuePos{0};
+      std::atomic<uint64_t> m_dropped{0};
+      std::atomic<bool> m_stopping{false};
+      std::thread m_consumer;
+    };
+
+    // Installed loggers are never released before exit, so the hot path can
+    // use a plain atomic pointer instead of reference counting per message
+    std::mutex g_loggersMutex;
+    std::vector<std::shared_ptr<IWfsLogger>> g_loggers{std::make_shared<ConsoleLogger>()};
+    std::atomic<IWfsLogger *> g_logger{g_loggers.front().get()};
+
+  } // namespace
+
+  namespace log
+  {
+
+    std::atomic<int> g_level{static_cast<int>(WfsLogLevel::Warn)};
+
+    fmt::memory_buffer &ThreadBuffer()
+    {
+      thread_local fmt::memory_buffer buffer;
+      return buffer;
+    }
+
+    void Write(WfsLogLevel level, std::string_view message)
+    {
+      IWfsLogger *logger = g_logger.load(std::memory_order_acquire);
+      if (logger)
+      {
+        logger->Log(level, message);
+      }
+    }
+
+  } // namespace log
+
+  void SetWfsLogger(const std::shared_ptr<IWfsLogger> &logger)
+  {
+    std::lock_guard<std::mutex> lock(g_loggersMutex);
+    if (logger)
+    {
+      g_loggers.push_back(logger);
+    }
+    g_logger.store(logger.get(), std::memory_order_release);
+  }
+
+  void SetWfsLogLevel(WfsLogLevel level)
+  {
+    log::g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+  }
+
+  void CreateWfsConsoleLogger(std::shared_ptr<IWfsLogger> &logger)
+  {
+    logger = std::make_shared<ConsoleLogger>();
+  }
+
+  void CreateWfsAsyncLogger(std::shared_ptr<IWfsLogger> &logger,
+                            const std::shared_ptr<IWfsLogger> &sink,
+                            size_t capacity)
+  {
+    logger = std::make_shared<AsyncRingLogger>(sink, capacity);
+  }
+
+} // namespace wfs_client
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <string_view>
+
+#include "wfs_client/logger.hpp"
+
+// Compile-time minimum log level (0 = Trace ... 5 = Off); log statements below
+// it are discarded by the compiler, arguments included
+#ifndef WFS_CLIENT_LOG_MIN_LEVEL
+#define WFS_CLIENT_LOG_MIN_LEVEL 0
+#endif
+
+namespace wfs_client
+{
+  namespace log
+  {
+
+    // Runtime minimum level, see SetWfsLogLevel
+    extern std::atomic<int> g_level;
+
+    inline bool Enabled(WfsLogLevel level)
+    {
+      return static_cast<int>(level) >= g_level.load(std::memory_order_relaxed);
+    }
+
+    // Per-thread scratch buffer messages are formatted into
+    fmt::memory_buffer &ThreadBuffer();
+
+    // Hand a formatted message to the installed logger
+    void Write(WfsLogLevel level, std::string_view message);
+
+  } // namespace log
+} // namespace wfs_client
+
+// Formatting only happens when the level is enabled, so a disabled statement
+// costs one relaxed load and a compare; enabled ones format without allocating
+#define WFS_LOG(level, ...)                                                     \
+  do                                                                            \
+  {                                                                             \
+    if constexpr (static_cast<int>(level) >= WFS_CLIENT_LOG_MIN_LEVEL)          \
+    {                                                                           \
+      if (::wfs_client::log::Enabled(level))                                    \
+      {                                                                         \
+        ::fmt::memory_buffer &wfsLogBuffer = ::wfs_client::log::ThreadBuffer(); \
+        wfsLogBuffer.clear();                                                   \
+        ::fmt::format_to(::fmt::appender(wfsLogBuffer), __VA_ARGS__);          \
+        ::wfs_client::log::Write(level, std::string_view(wfsLogBuffer.data(),   \
+                                                         wfsLogBuffer.size())); \
+      }                                                                         \
+    }                                                                           \
+  } while (false)
+
+#define WFS_LOG_TRACE(...) WFS_LOG(::wfs_client::WfsLogLevel::Trace, __VA_ARGS__)
+#define WFS_LOG_DEBUG(...) WFS_LOG(::wfs_client::WfsLogLevel::Debug, __VA_ARGS__)
+#define WFS_LOG_INFO(...) WFS_LOG(::wfs_client::WfsLogLevel::Info, __VA_ARGS__)
+#define WFS_LOG_WARN(...) WFS_LOG(::wfs_client::WfsLogLevel::Warn, __VA_ARGS__)
+#define WFS_LOG_ERROR(...) WFS_LOG(::wfs_client::WfsLogLevel::Error, __VA_ARGS__)
@@ -0,0 +1,60 @@
+#include "wfs_metrics.hpp"
+
+#include <fmt/format.h>
+
+namespace wfs_client
+{
+
+  void DumpWfsMetrics(const WfsMetricsSnapshot &metrics, std::string &outText)
+  {
+    fmt::memory_buffer out;
+    fmt::format_to(fmt::appender(out), "{:<8} {:>9} {:>7} {:>10} {:>10} {:>10} {:>10} | {:>10} {:>10} {:>10} {:>11}\n",
+                   "op", "calls", "errors", "mean(us)", "p50(us)", "p99(us)", "max(us)",
+                   "serialize", "send", "wait", "deserialize");
+
+    for (size_t op = 0; op < kWfsOpTypeCount; ++op)
+    {
+      const WfsOpMetrics &ops = metrics.ops[op];
+      if (ops.calls == 0)
+      {
+        continue;
+      }
+      fmt::format_to(fmt::appender(out), "{:<8} {:>9} {:>7} {:>10.1f} {:>10} {:>10} {:>10} | {:>10.1f} {:>10.1f} {:>10.1f} {:>11.1f}\n",
+                     WfsOpTypeName(static_cast<WfsOpType>(op)), ops.calls, ops.errors,
+                     ops.latency.MeanMicros(), ops.latency.Percentile(0.5), ops.latency.Percentile(0.99),
+                     ops.latency.maxMicros,
+                     ops.PhaseMeanMicros(WfsRpcPhase::Serialize), ops.PhaseMeanMicros(WfsRpcPhase::Send),
+                     ops.PhaseMeanMicros(WfsRpcPhase::Wait), ops.PhaseMeanMicros(WfsRpcPhase::Deserialize));
+    }
+
+    fmt::format_to(fmt::appender(out), "phase columns are mean microseconds per round trip\n");
+    fmt::format_to(fmt::appender(out), "bytes sent: {}, received: {}, in flight: {}, reconnects: {}\n",
+                   metrics.bytesSent, metrics.bytesReceived, metrics.inFlight, metrics.reconnects);
+    fmt::format_to(fmt::appender(out), "listing cache hits: {}, misses: {}, coalesced reads: {}\n",
+                   metrics.listingCacheHits, metrics.listingCacheMisses, metrics.coalescedReads);
+    fmt::format_to(fmt::appender(out), "circuit breaker: {}, opened: {}, rejected: {}\n",
+                   WfsBreakerStateName(metrics.breakerState),
+                   metrics.breakerTransitions[static_cast<size_t>(WfsBreakerState::Open)], metrics.breakerRejected);
+    fmt::format_to(fmt::appender(out), "health pings: {}, health reconnects: {}, connection rtt: {} us\n",
+                   metrics.healthPings, metrics.healthReconnects, metrics.connectionRttMicros);
+    fmt::format_to(fmt::appender(out), "hedged reads: {}, hedge wins: {}\n", metrics.hedgedReads, metrics.hedgeWins);
+
+    static const char *const kTransportErrorNames[WfsMetricsSnapshot::kTransportErrorTypes] = {
+        "UNKNOWN", "NOT_OPEN", "TIMED_OUT", "END_OF_FILE", "INTERRUPTED",
+        "BAD_ARGS", "CORRUPTED_DATA", "INTERNAL_ERROR", "CLIENT_DISCONNECT"};
+    fmt::format_to(fmt::appender(out), "transport errors:");
+    bool any = false;
+    for (size_t type = 0; type < WfsMetricsSnapshot::kTransportErrorTypes; ++type)
+    {
+      if (metrics.transportErrors[type] > 0)
+      {
+        fmt::format_to(fmt::appender(out), " {}={}", kTransportErrorNames[type], metrics.transportErrors[type]);
+        any = true;
+      }
+    }
+    fmt::format_to(fmt::appender(out), "{}\n", any ? "" : " none");
+
+    outText.assign(out.data(), out.size());
+  }
+
+} // namespace wfs_client
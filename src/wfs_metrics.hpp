@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "wfs_client/metrics.hpp"
+
+namespace wfs_client
+{
+
+  // Client counters. Each thread records into its own cache-line-aligned
+  // stripe with relaxed atomic increments, so recording never takes a lock
+  // and threads do not contend on shared cache lines; snapshots sum the
+  // stripes.
+  class WfsMetricsRecorder
+  {
+  public:
+    static constexpr size_t kStripes = 8;
+
+    WfsMetricsRecorder()
+        : m_stripes(std::make_unique<Stripe[]>(kStripes))
+    {
+    }
+
+    WfsMetricsRecorder(const WfsMetricsRecorder &) = delete;
+    WfsMetricsRecorder &operator=(const WfsMetricsRecorder &) = delete;
+
+    void RecordOp(WfsOpType op, uint64_t elapsedNanos, bool ok)
+    {
+      OpCounters &counters = LocalStripe().ops[static_cast<size_t>(op)];
+      const uint64_t value = elapsedNanos / 1000;
+
+      counters.calls.fetch_add(1, std::memory_order_relaxed);
+      if (!ok)
+      {
+        counters.errors.fetch_add(1, std::memory_order_relaxed);
+      }
+      counters.buckets[WfsLatencyHistogram::BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+      counters.sumMicros.fetch_add(value, std::memory_order_relaxed);
+
+      StoreMax(counters.maxMicros, value);
+    }
+
+    // Phase durations of one round trip, indexed by WfsRpcPhase
+    void RecordPhases(WfsOpType op, const uint64_t (&phaseNanos)[kWfsRpcPhaseCount])
+    {
+      OpCounters &counters = LocalStripe().ops[static_cast<size_t>(op)];
+      counters.phaseSamples.fetch_add(1, std::memory_order_relaxed);
+      for (size_t phase = 0; phase < kWfsRpcPhaseCount; ++phase)
+      {
+        counters.phaseSumNanos[phase].fetch_add(phaseNanos[phase], std::memory_order_relaxed);
+        StoreMax(counters.phaseMaxNanos[phase], phaseNanos[phase]);
+      }
+    }
+
+    // Gauge of RPCs waiting for a reply
+    void AddInFlight(int64_t delta)
+    {
+      LocalStripe().inFlight.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    void AddOpenConnections(int64_t delta)
+    {
+      m_openConnections.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    void AddReconnect()
+    {
+      LocalStripe().reconnects.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void RecordListingCacheLookup(bool hit)
+    {
+      Stripe &stripe = LocalStripe();
+      (hit ? stripe.listingCacheHits : stripe.listingCacheMisses).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void AddBytesSent(uint64_t bytes)
+    {
+      LocalStripe().bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void AddBytesReceived(uint64_t bytes)
+    {
+      LocalStripe().bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // type is a TTransportException::TTransportExceptionType
+    void RecordTransportError(int type)
+    {
+      if (type < 0 || static_cast<size_t>(type) >= WfsMetricsSnapshot::kTransportErrorTypes)
+      {
+        type = 0;
+      }
+      LocalStripe().transportErrors[static_cast<size_t>(type)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    WfsMetricsSnapshot Snapshot() const
+    {
+      WfsMetricsSnapshot snapshot;
+      for (size_t s = 0; s < kStripes; ++s)
+      {
+        const Stripe &stripe = m_stripes[s];
+        for (size_t op = 0; op < kWfsOpTypeCount; ++op)
+        {
+          const OpCounters &counters = stripe.ops[op];
+          WfsOpMetrics &out = snapshot.ops[op];
+          out.calls += counters.calls.load(std::memory_order_relaxed);
+          out.errors += counters.errors.load(std::memory_order_relaxed);
+          for (size_t i = 0; i < WfsLatencyHistogram::kBucketCount; ++i)
+          {
+            const uint64_t count = counters.buckets[i].load(std::memory_order_relaxed);
+            out.latency.counts[i] += count;
+            out.latency.count += count;
+          }
+          out.latency.sumMicros += counters.sumMicros.load(std::memory_order_relaxed);
+          const uint64_t max = counters.maxMicros.load(std::memory_order_relaxed);
+          out.latency.maxMicros = std::max(out.latency.maxMicros, max);
+          out.phaseSamples += counters.phaseSamples.load(std::memory_order_relaxed);
+          for (size_t phase = 0; phase < kWfsRpcPhaseCount; ++phase)
+          {
+            out.phaseSumNanos[phase] += counters.phaseSumNanos[phase].load(std::memory_order_relaxed);
+            out.phaseMaxNanos[phase] = std::max(out.phaseMaxNanos[phase],
+                                                counters.phaseMaxNanos[phase].load(std::memory_order_relaxed));
+          }
+        }
+        snapshot.inFlight += stripe.inFlight.load(std::memory_order_relaxed);
+        snapshot.reconnects += stripe.reconnects.load(std::memory_order_relaxed);
+        snapshot.listingCacheHits += stripe.listingCacheHits.load(std::memory_order_relaxed);
+        snapshot.listingCacheMisses += stripe.listingCacheMisses.load(std::memory_order_relaxed);
+        snapshot.bytesSent += stripe.bytesSent.load(std::memory_order_relaxed);
+        snapshot.bytesReceived += stripe.bytesReceived.load(std::memory_order_relaxed);
+        for (size_t t = 0; t < WfsMetricsSnapshot::kTransportErrorTypes; ++t)
+        {
+          snapshot.transportErrors[t] += stripe.transportErrors[t].load(std::memory_order_relaxed);
+        }
+      }
+      snapshot.openConnections = m_openConnections.load(std::memory_order_relaxed);
+      return snapshot;
+    }
+
+  private:
+    struct OpCounters
+    {
+      std::atomic<uint64_t> calls{0};
+      std::atomic<uint64_t> errors{0};
+      std::atomic<uint64_t> sumMicros{0};
+      std::atomic<uint64_t> maxMicros{0};
+      std::atomic<uint64_t> buckets[WfsLatencyHistogram::kBucketCount]{};
+      std::atomic<uint64_t> phaseSamples{0};
+      std::atomic<uint64_t> phaseSumNanos[kWfsRpcPhaseCount]{};
+      std::atomic<uint64_t> phaseMaxNanos[kWfsRpcPhaseCount]{};
+    };
+
+    static void StoreMax(std::atomic<uint64_t> &target, uint64_t value)
+    {
+      uint64_t max = target.load(std::memory_order_relaxed);
+      while (value > max &&
+             !target.compare_exchange_weak(max, value, std::memory_order_relaxed))
+      {
+      }
+    }
+
+    struct alignas(64) Stripe
+    {
+      OpCounters ops[kWfsOpTypeCount];
+      std::atomic<int64_t> inFlight{0};
+      std::atomic<uint64_t> reconnects{0};
+      std::atomic<uint64_t> listingCacheHits{0};
+      std::atomic<uint64_t> listingCacheMisses{0};
+      std::atomic<uint64_t> bytesSent{0};
+      std::atomic<uint64_t> bytesReceived{0};
+      std::atomic<uint64_t> transportErrors[WfsMetricsSnapshot::kTransportErrorTypes]{};
+    };
+
+    // Threads are assigned stripes round-robin on first use
+    Stripe &LocalStripe()
+    {
+      static std::atomic<size_t> nextStripe{0};
+      thread_local const size_t index = nextStripe.fetch_add(1, std::memory_order_relaxed) % kStripes;
+      return m_stripes[index];
+    }
+
+    std::unique_ptr<Stripe[]> m_stripes;
+    std::atomic<int64_t> m_openConnections{0};
+  };
+
+} // namespace wfs_client
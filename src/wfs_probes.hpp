@@ -0,0 +1,28 @@
+#pragma once
+
+// Static USDT probes (provider "wfs_client") for perf/bpftrace. Enabled with
+// -DWFS_CLIENT_ENABLE_USDT=ON on Linux; each probe compiles to a single NOP
+// until a tracer attaches. Elsewhere the macros expand to nothing.
+//
+//   request__start(op, path_len, bytes)
+//   request__done(op, path_len, bytes, duration_ns, ok)
+//   retry(op, attempt)
+//   reconnect(connection_id)
+//   cache__hit(path_len)
+//   cache__miss(path_len)
+//
+// op is the WfsOpType value.
+
+#if defined(WFS_CLIENT_USDT) && defined(__linux__)
+#include <sys/sdt.h>
+
+#define WFS_PROBE1(name, a1) DTRACE_PROBE1(wfs_client, name, a1)
+#define WFS_PROBE2(name, a1, a2) DTRACE_PROBE2(wfs_client, name, a1, a2)
+#define WFS_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(wfs_client, name, a1, a2, a3)
+#define WFS_PROBE5(name, a1, a2, a3, a4, a5) DTRACE_PROBE5(wfs_client, name, a1, a2, a3, a4, a5)
+#else
+#define WFS_PROBE1(name, a1) do { } while (false)
+#define WFS_PROBE2(name, a1, a2) do { } while (false)
+#define WFS_PROBE3(name, a1, a2, a3) do { } while (false)
+#define WFS_PROBE5(name, a1, a2, a3, a4, a5) do { } while (false)
+#endif
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <thrift/TConfiguration.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/transport/TSocket.h>
+#include <thrift/transport/TTransportException.h>
+#include <thrift/transport/TTransportUtils.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gen-cpp/WfsIface.h"
+#include "gen-cpp/wfs_types.h"
+#include "call_deadline.hpp"
+#include "deadline_transport.hpp"
+#include "fault_injection_transport.hpp"
+#include "network_sim_transport.hpp"
+#include "phase_transport.hpp"
+#include "wfs_client/datatype_.hpp"
+#include "wfs_log.hpp"
+
+namespace wfs_client
+{
+
+  // Socket/transport/protocol stack of one client connection
+  struct WfsTransportStack
+  {
+    std::shared_ptr<apache::thrift::transport::TSocket> socket;
+    std::shared_ptr<PhaseTransport> phases; // socket time accounting, see RpcScope::Call
+    std::shared_ptr<apache::thrift::transport::TTransport> transport;
+    std::shared_ptr<apache::thrift::protocol::TProtocol> protocol;
+    std::shared_ptr<WfsIfaceClient> client;
+  };
+
+  // Build (without opening) the transport stack every connection uses. With
+  // call, exchanges are held to the deadline/cancellation token it holds;
+  // with rtt, reply waits to its adaptive timeouts.
+  inline WfsTransportStack CreateTransportStack(const WfsConnectionParams &params,
+                                                const CallDeadline *call = nullptr,
+                                                RttEstimator *rtt = nullptr)
+  {
+    using namespace apache::thrift::protocol;
+    using namespace apache::thrift::transport;
+
+    WfsTransportStack stack;
+
+    // Create socket
+    auto config = std::make_shared<apache::thrift::TConfiguration>(params.maxMessageSize);
+    stack.socket = std::make_shared<TSocket>(params.serverIp, params.serverPort, config);
+
+    // Set timeout parameters
+    stack.socket->setConnTimeout(params.connectTimeout);
+    stack.socket->setRecvTimeout(params.receiveTimeout);
+    stack.socket->setSendTimeout(params.sendTimeout);
+
+    // Create transport layer and protocol
+    std::shared_ptr<TTransport> link = stack.socket;
+    if (call)
+    {
+      link = std::make_shared<DeadlineTransport>(link, stack.socket, call, rtt, params);
+    }
+    if (auto injector = std::dynamic_pointer_cast<FaultInjector>(params.faultInjector))
+    {
+      link = std::make_shared<FaultInjectionTransport>(link, injector, params.receiveTimeout);
+    }
+    std::shared_ptr<NetworkSimTransport> simulated;
+    if (params.networkSimulation.enabled)
+    {
+      simulated = std::make_shared<NetworkSimTransport>(link, params.networkSimulation, params.receiveTimeout);
+      link = simulated;
+    }
+    stack.phases = std::make_shared<PhaseTransport>(link);
+    stack.transport = std::make_shared<TBufferedTransport>(stack.phases, 8192, config);
+    stack.protocol = std::make_shared<TCompactProtocol>(stack.transport);
+    if (simulated)
+    {
+      stack.protocol = std::make_shared<NetworkSimProtocol>(stack.protocol, simulated);
+    }
+
+    // Create client
+    stack.client = std::make_shared<WfsIfaceClient>(stack.protocol);
+    return stack;
+  }
+
+  // Convert local file data to the Thrift structure
+  inline WfsFile ToWfsFile(const WfsFileData &fileData)
+  {
+    WfsFile wf;
+    wf.__set_data(fileData.data);
+    wf.__set_name(fileData.name);
+    if (fileData.compress != 0)
+    {
+      wf.__set_compress(fileData.compress);
+    }
+    return wf;
+  }
+
+  // Pipelined Append: every request is sent before the first reply is read,
+  // so the whole batch costs a single round trip. One result is appended per
+  // reply; on a transport failure the exception propagates and results holds
+  // the replies received so far.
+  inline void PipelinedAppend(WfsIfaceClient &client,
+                              const std::vector<const WfsFileData *> &files,
+                              std::vector<WfsResult> &results)
+  {
+    for (const WfsFileData *file : files)
+    {
+      client.send_Append(ToWfsFile(*file));
+    }
+
+    results.reserve(results.size() + files.size());
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+      WfsAck ack;
+      client.recv_Append(ack);
+      if (ack.ok)
+      {
+        results.push_back(WfsResult::Success());
+      }
+      else
+      {
+        results.push_back(WfsResult::Failure(ack.error.code, ack.error.info, WfsErrorCategory::Server));
+      }
+    }
+  }
+
+  // Independent authenticated connection used by background workers
+  class WfsSession
+  {
+  public:
+    WfsSession(const WfsConnectionParams &params, const WfsAuthInfo &authInfo)
+        : m_params(params), m_authInfo(authInfo)
+    {
+    }
+
+    ~WfsSession()
+    {
+      Close();
+    }
+
+    WfsSession(const WfsSession &) = delete;
+    WfsSession &operator=(const WfsSession &) = delete;
+
+    // Connect and authenticate
+    WfsResult Open()
+    {
+      Close();
+      try
+      {
+        m_stack = CreateTransportStack(m_params);
+        m_stack.transport->open();
+
+        WfsAuth auth;
+        auth.__set_name(m_authInfo.username);
+        auth.__set_pwd(m_authInfo.password);
+        WfsAck ack;
+        m_stack.client->Auth(ack, auth);
+        if (!ack.ok)
+        {
+          Close();
+          return WfsResult::Failure(ack.error.code, ack.error.info, WfsErrorCategory::Server);
+        }
+
+        m_open = true;
+        return WfsResult::Success();
+      }
+      catch (const std::exception &e)
+      {
+        Close();
+        return WfsResult::Failure(-1, std::string("Session open failed: ") + e.what());
+      }
+    }
+
+    void Close()
+    {
+      if (m_stack.transport)
+      {
+        try
+        {
+          m_stack.transport->close();
+        }
+        catch (...)
+        {
+          // Ignore exceptions during disconnection
+        }
+      }
+      m_stack = WfsTransportStack();
+      m_open = false;
+    }
+
+    bool IsOpen() const
+    {
+      return m_open;
+    }
+
+    // Pipelined Append; returns fewer results than files when the connection
+    // failed, in which case the session is closed
+    std::vector<WfsResult> Append(const std::vector<const WfsFileData *> &files)
+    {
+      std::vector<WfsResult> results;
+      if (!m_open)
+      {
+        return results;
+      }
+
+      try
+      {
+        PipelinedAppend(*m_stack.client, files, results);
+      }
+      catch (const std::exception &e)
+      {
+        WFS_LOG_WARN("Session append failed after {}/{} replies: {}",
+                     results.size(), files.size(), e.what());
+        Close();
+      }
+      return results;
+    }
+
+  private:
+    WfsConnectionParams m_params;
+    WfsAuthInfo m_authInfo;
+    WfsTransportStack m_stack;
+    bool m_open{false};
+  };
+
+} // namespace wfs_client
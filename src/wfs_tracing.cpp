@@ -0,0 +1,349 @@
+#include "wfs_tracing.hpp"
+
+#include <fmt/format.h>
+
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace wfs_client
+{
+
+  namespace
+  {
+
+    // Per-thread trace state: caller context and the innermost active span
+    struct ThreadTraceState
+    {
+      WfsTraceContext context;
+      bool hasContext{false};
+      uint64_t activeSpanId{0};
+      uint64_t activeTraceIdHigh{0};
+      uint64_t activeTraceIdLow{0};
+      uint64_t rngState{0};
+    };
+
+    ThreadTraceState &State()
+    {
+      thread_local ThreadTraceState state;
+      return state;
+    }
+
+    // splitmix64, seeded per thread
+    uint64_t NextRandom()
+    {
+      ThreadTraceState &state = State();
+      if (state.rngState == 0)
+      {
+        std::random_device device;
+        state.rngState = (static_cast<uint64_t>(device()) << 32) ^ device() ^
+                         static_cast<uint64_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+      }
+      uint64_t z = (state.rngState += 0x9E3779B97F4A7C15ull);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      return z ^ (z >> 31);
+    }
+
+    uint64_t RandomId()
+    {
+      uint64_t id = 0;
+      while (id == 0)
+      {
+        id = NextRandom();
+      }
+      return id;
+    }
+
+    uint64_t ThreadId()
+    {
+      thread_local const uint64_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+      return id;
+    }
+
+    int64_t ToMicros(std::chrono::steady_clock::duration duration)
+    {
+      return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+
+    std::mutex g_sinksMutex;
+    std::vector<std::shared_ptr<IWfsTraceSink>> g_sinks;
+
+    // Root spans are kept when a random 64-bit value is below this
+    std::atomic<uint64_t> g_sampleThreshold{std::numeric_limits<uint64_t>::max()};
+
+    bool SampleRoot()
+    {
+      const uint64_t threshold = g_sampleThreshold.load(std::memory_order_relaxed);
+      return threshold == std::numeric_limits<uint64_t>::max() || NextRandom() < threshold;
+    }
+
+    class MemoryTraceSink : public IWfsMemoryTraceSink
+    {
+    public:
+      explicit MemoryTraceSink(size_t maxSpans)
+          : m_maxSpans(maxSpans == 0 ? 1 : maxSpans)
+      {
+      }
+
+      void Export(const WfsSpan &span) override
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_spans.size() >= m_maxSpans)
+        {
+          m_spans.pop_front();
+        }
+        m_spans.push_back(span);
+      }
+
+      std::vector<WfsSpan> Spans() const override
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return std::vector<WfsSpan>(m_spans.begin(), m_spans.end());
+      }
+
+      void Clear() override
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_spans.clear();
+      }
+
+    private:
+      mutable std::mutex m_mutex;
+      std::deque<WfsSpan> m_spans;
+      size_t m_maxSpans;
+    };
+
+    std::string EscapeJson(std::string_view value)
+    {
+      std::string escaped;
+      escaped.reserve(value.size());
+      for (char c : value)
+      {
+        switch (c)
+        {
+        case '"':
+          escaped += "\\\"";
+          break;
+        case '\\':
+          escaped += "\\\\";
+          break;
+        case '\n':
+          escaped += "\\n";
+          break;
+        case '\r':
+          escaped += "\\r";
+          break;
+        case '\t':
+          escaped += "\\t";
+          break;
+        default:
+          if (static_cast<unsigned char>(c) < 0x20)
+          {
+            escaped += fmt::format("\\u{:04x}", static_cast<int>(c));
+          }
+          else
+          {
+            escaped += c;
+          }
+          break;
+        }
+      }
+      return escaped;
+    }
+
+    // Chrome trace event format ("X" complete events in a JSON array)
+    class ChromeTraceSink : public IWfsTraceSink
+    {
+    public:
+      explicit ChromeTraceSink(FILE *file)
+          : m_file(file)
+      {
+        fputs("[\n", m_file);
+      }
+
+      ~ChromeTraceSink() override
+      {
+        fputs("\n]\n", m_file);
+        fclose(m_file);
+      }
+
+      void Export(const WfsSpan &span) override
+      {
+        const std::string event = fmt::format(
+            "{{\"name\":\"{}\",\"cat\":\"wfs\",\"ph\":\"X\",\"ts\":{},\"dur\":{},\"pid\":0,\"tid\":{},"
+            "\"args\":{{\"path\":\"{}\",\"trace_id\":\"{:016x}{:016x}\",\"span_id\":\"{:016x}\","
+            "\"parent_id\":\"{:016x}\",\"bytes\":{},\"ok\":{}}}}}",
+            EscapeJson(span.name), span.startMicros, span.durationMicros,
+            static_cast<uint32_t>(span.threadId), EscapeJson(span.path),
+            span.traceIdHigh, span.traceIdLow, span.spanId, span.parentSpanId,
+            span.bytes, span.ok);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_first)
+        {
+          fputs(",\n", m_file);
+        }
+        m_first = false;
+        fwrite(event.data(), 1, event.size(), m_file);
+      }
+
+      void Flush() override
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        fflush(m_file);
+      }
+
+    private:
+      std::mutex m_mutex;
+      FILE *m_file;
+      bool m_first{true};
+    };
+
+  } // namespace
+
+  namespace trace
+  {
+
+    std::atomic<IWfsTraceSink *> g_sink{nullptr};
+
+  } // namespace trace
+
+  void TraceSpan::Begin(IWfsTraceSink *sink, std::string_view name, std::string_view path)
+  {
+    ThreadTraceState &state = State();
+    if (state.activeSpanId != 0)
+    {
+      // Nested in a sampled span of this thread
+      m_span.traceIdHigh = state.activeTraceIdHigh;
+      m_span.traceIdLow = state.activeTraceIdLow;
+      m_span.parentSpanId = state.activeSpanId;
+    }
+    else if (state.hasContext)
+    {
+      if (!state.context.sampled)
+      {
+        return;
+      }
+      m_span.traceIdHigh = state.context.traceIdHigh;
+      m_span.traceIdLow = state.context.traceIdLow;
+      m_span.parentSpanId = state.context.parentSpanId;
+    }
+    else
+    {
+      if (!SampleRoot())
+      {
+        return;
+      }
+      m_span.traceIdHigh = RandomId();
+      m_span.traceIdLow = RandomId();
+    }
+
+    m_sink = sink;
+    m_span.spanId = RandomId();
+    m_span.name.assign(name.data(), name.size());
+    m_span.path.assign(path.data(), path.size());
+    m_span.threadId = ThreadId();
+    m_span.startMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::system_clock::now().time_since_epoch())
+                             .count();
+    m_start = Clock::now();
+
+    m_outerSpanId = state.activeSpanId;
+    m_outerTraceIdHigh = state.activeTraceIdHigh;
+    m_outerTraceIdLow = state.activeTraceIdLow;
+    state.activeSpanId = m_span.spanId;
+    state.activeTraceIdHigh = m_span.traceIdHigh;
+    state.activeTraceIdLow = m_span.traceIdLow;
+  }
+
+  void TraceSpan::End()
+  {
+    m_span.durationMicros = ToMicros(Clock::now() - m_start);
+
+    ThreadTraceState &state = State();
+    state.activeSpanId = m_outerSpanId;
+    state.activeTraceIdHigh = m_outerTraceIdHigh;
+    state.activeTraceIdLow = m_outerTraceIdLow;
+
+    m_sink->Export(m_span);
+  }
+
+  void TraceSpan::AddChild(std::string_view name, Clock::time_point start, Clock::duration duration)
+  {
+    if (!m_sink)
+    {
+      return;
+    }
+
+    WfsSpan child;
+    child.traceIdHigh = m_span.traceIdHigh;
+    child.traceIdLow = m_span.traceIdLow;
+    child.spanId = RandomId();
+    child.parentSpanId = m_span.spanId;
+    child.name.assign(name.data(), name.size());
+    child.startMicros = m_span.startMicros + ToMicros(start - m_start);
+    child.durationMicros = ToMicros(duration);
+    child.threadId = m_span.threadId;
+    child.ok = true;
+    m_sink->Export(child);
+  }
+
+  void SetWfsTraceSink(const std::shared_ptr<IWfsTraceSink> &sink, double sampleRate)
+  {
+    uint64_t threshold = std::numeric_limits<uint64_t>::max();
+    if (sampleRate <= 0.0)
+    {
+      threshold = 0;
+    }
+    else if (sampleRate < 1.0)
+    {
+      threshold = static_cast<uint64_t>(sampleRate * 18446744073709551616.0);
+    }
+
+    std::lock_guard<std::mutex> lock(g_sinksMutex);
+    if (sink)
+    {
+      g_sinks.push_back(sink);
+    }
+    g_sampleThreshold.store(threshold, std::memory_order_relaxed);
+    trace::g_sink.store(sink.get(), std::memory_order_release);
+  }
+
+  void SetWfsTraceContext(const WfsTraceContext &context)
+  {
+    ThreadTraceState &state = State();
+    state.context = context;
+    state.hasContext = true;
+  }
+
+  void ClearWfsTraceContext()
+  {
+    ThreadTraceState &state = State();
+    state.context = WfsTraceContext();
+    state.hasContext = false;
+  }
+
+  void CreateWfsMemoryTraceSink(std::shared_ptr<IWfsMemoryTraceSink> &sink, size_t maxSpans)
+  {
+    sink = std::make_shared<MemoryTraceSink>(maxSpans);
+  }
+
+  bool CreateWfsChromeTraceSink(std::shared_ptr<IWfsTraceSink> &sink, const std::string &filePath)
+  {
+    FILE *file = fopen(filePath.c_str(), "wb");
+    if (!file)
+    {
+      return false;
+    }
+    sink = std::make_shared<ChromeTraceSink>(file);
+    return true;
+  }
+
+} // namespace wfs_client
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+#include "wfs_client/tracing.hpp"
+
+namespace wfs_client
+{
+
+  namespace trace
+  {
+
+    // Current sink (nullptr when tracing is disabled); sinks are kept alive
+    // until exit so the hot path needs no reference counting
+    extern std::atomic<IWfsTraceSink *> g_sink;
+
+  } // namespace trace
+
+  // Span of one client operation. Costs a single atomic load when tracing is
+  // disabled; unsampled spans never allocate. Spans opened while another
+  // span is active on the same thread become its children.
+  class TraceSpan
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TraceSpan(std::string_view name, std::string_view path = {})
+    {
+      IWfsTraceSink *sink = trace::g_sink.load(std::memory_order_acquire);
+      if (sink)
+      {
+        Begin(sink, name, path);
+      }
+    }
+
+    ~TraceSpan()
+    {
+      if (m_sink)
+      {
+        End();
+      }
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    bool Active() const
+    {
+      return m_sink != nullptr;
+    }
+
+    void SetOk(bool ok)
+    {
+      m_span.ok = ok;
+    }
+
+    void SetBytes(uint64_t bytes)
+    {
+      m_span.bytes = bytes;
+    }
+
+    // Export a finished child span, placed relative to this span's start
+    void AddChild(std::string_view name, Clock::time_point start, Clock::duration duration);
+
+  private:
+    void Begin(IWfsTraceSink *sink, std::string_view name, std::string_view path);
+    void End();
+
+    IWfsTraceSink *m_sink{nullptr};
+    WfsSpan m_span;
+    Clock::time_point m_start;
+
+    // Enclosing span restored when this one ends
+    uint64_t m_outerSpanId{0};
+    uint64_t m_outerTraceIdHigh{0};
+    uint64_t m_outerTraceIdLow{0};
+  };
+
+} // namespace wfs_client
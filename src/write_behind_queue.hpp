@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "call_deadline.hpp"
+#include "wfs_client/datatype_.hpp"
+
+namespace wfs_client
+{
+
+  // Write-behind upload queue: uploads are acknowledged immediately and
+  // written by a background thread in batches. A queued upload is replaced in
+  // place by a later upload to the same path, so repeated rewrites of one
+  // object cost a single Append. The call's deadline only bounds the wait
+  // for room in the queue: once acknowledged, an upload is dropped unsent
+  // (and reported by the next Flush()) only if its token is cancelled
+  // before its batch is taken.
+  class WriteBehindQueue
+  {
+  public:
+    using Batch = std::vector<std::shared_ptr<const WfsFileData>>;
+
+    // Writes a batch and returns one result per file, in order
+    using BatchSink = std::function<std::vector<WfsResult>(const Batch &)>;
+
+    // Failures kept for the next Flush() when nobody is flushing
+    static constexpr size_t kMaxRetainedFailures = 1024;
+
+    WriteBehindQueue(BatchSink sink, std::chrono::milliseconds flushInterval,
+                     size_t maxBatch, size_t maxQueuedBytes)
+        : m_sink(std::move(sink)),
+          m_flushInterval(flushInterval),
+          m_maxBatch(maxBatch > 0 ? maxBatch : 1),
+          m_maxQueuedBytes(maxQueuedBytes)
+    {
+      m_worker = std::thread([this]()
+                             { Run(); });
+    }
+
+    ~WriteBehindQueue()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+      }
+      m_workCv.notify_all();
+      if (m_worker.joinable())
+      {
+        m_worker.join();
+      }
+    }
+
+    WriteBehindQueue(const WriteBehindQueue &) = delete;
+    WriteBehindQueue &operator=(const WriteBehindQueue &) = delete;
+
+    // Queue an upload, replacing a still-queued upload of the same path.
+    // Blocks while the queue holds more than maxQueuedBytes, at most until
+    // the call has to stop.
+    WfsResult Enqueue(const WfsFileData &fileData, const CallDeadline &call = CallDeadline())
+    {
+      auto file = std::make_shared<const WfsFileData>(fileData);
+
+      std::unique_lock<std::mutex> lock(m_mutex);
+      auto hasRoom = [this]()
+      { return m_stopping || m_maxQueuedBytes == 0 || m_queuedBytes < m_maxQueuedBytes; };
+      if (!call.Bounded())
+      {
+        m_doneCv.wait(lock, hasRoom);
+      }
+      while (!hasRoom())
+      {
+        WfsResult status = call.Status();
+        if (!status)
+        {
+          return status;
+        }
+        m_doneCv.wait_for(lock, CallDeadline::kPollInterval);
+      }
+
+      auto it = m_index.find(file->name);
+      if (it != m_index.end())
+      {
+        // Coalesce: keep the queue position and the (older) epoch, so a
+        // Flush() already waiting for it also waits for the new payload
+        Entry &entry = *it->second;
+        m_queuedBytes -= entry.file->data.size();
+        entry.file = std::move(file);
+        if (!entry.call.SameToken(call))
+        {
+          // Two acknowledged uploads: neither token may drop the other one's data
+          entry.call = CallDeadline();
+        }
+        m_queuedBytes += entry.file->data.size();
+        ++m_coalesced;
+        return WfsResult::Success();
+      }
+
+      m_queuedBytes += file->data.size();
+      ++m_pendingByEpoch[m_epoch];
+      m_queue.push_back(Entry{std::move(file), m_epoch, call.CancellationOnly()});
+      m_index.emplace(m_queue.back().file->name, std::prev(m_queue.end()));
+      if (m_queue.size() >= m_maxBatch)
+      {
+        m_workCv.notify_one();
+      }
+      return WfsResult::Success();
+    }
+
+    // Barrier: wait until every upload queued before this call has been
+    // written and return the first failure among them
+    WfsResult Flush()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      const uint64_t barrier = m_epoch++;
+      m_flushRequested = true;
+      m_workCv.notify_one();
+
+      m_doneCv.wait(lock, [this, barrier]()
+                    { return m_pendingByEpoch.empty() || m_pendingByEpoch.begin()->first > barrier; });
+
+      WfsResult result = WfsResult::Success();
+      for (auto it = m_failures.begin(); it != m_failures.end() && it->first <= barrier;)
+      {
+        if (result)
+        {
+          result = it->second;
+        }
+        it = m_failures.erase(it);
+      }
+      return result;
+    }
+
+    // Latest queued or in-flight (not yet written) content of a path, for
+    // read-your-writes
+    std::shared_ptr<const WfsFileData> Pending(const std::string &path) const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_index.find(path);
+      if (it != m_index.end())
+      {
+        return it->second->file;
+      }
+      auto inFlight = m_inFlight.find(path);
+      if (inFlight != m_inFlight.end())
+      {
+        return inFlight->second;
+      }
+      return nullptr;
+    }
+
+    // Number of uploads absorbed by a later upload to the same path
+    uint64_t CoalescedCount() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_coalesced;
+    }
+
+  private:
+    struct Entry
+    {
+      std::shared_ptr<const WfsFileData> file;
+      uint64_t epoch;
+      CallDeadline call; // token only, cleared once uploads with different tokens coalesced
+    };
+
+    void RecordFailure(uint64_t epoch, const WfsResult &failure)
+    {
+      m_failures.emplace(epoch, failure);
+      if (m_failures.size() > kMaxRetainedFailures)
+      {
+        m_failures.erase(m_failures.begin());
+      }
+    }
+
+    void ReleaseEpoch(uint64_t epoch)
+    {
+      auto it = m_pendingByEpoch.find(epoch);
+      if (it != m_pendingByEpoch.end() && --it->second == 0)
+      {
+        m_pendingByEpoch.erase(it);
+      }
+    }
+
+    void Run()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      for (;;)
+      {
+        m_workCv.wait_for(lock, m_flushInterval, [this]()
+                          { return m_stopping || m_flushRequested || m_queue.size() >= m_maxBatch; });
+
+        if (m_queue.empty())
+        {
+          m_flushRequested = false;
+          if (m_stopping)
+          {
+            return;
+          }
+          continue;
+        }
+
+        // Take one batch; uploads queued meanwhile start a new entry
+        Batch batch;
+        std::vector<uint64_t> epochs;
+        batch.reserve(std::min(m_queue.size(), m_maxBatch));
+        epochs.reserve(batch.capacity());
+        while (!m_queue.empty() && batch.size() < m_maxBatch)
+        {
+          Entry &entry = m_queue.front();
+          m_index.erase(entry.file->name);
+          m_queuedBytes -= entry.file->data.size();
+          WfsResult status = entry.call.Status();
+          if (status)
+          {
+            m_inFlight[entry.file->name] = entry.file;
+            batch.push_back(std::move(entry.file));
+            epochs.push_back(entry.epoch);
+          }
+          else
+          {
+            // Cancelled while queued: never sent
+            RecordFailure(entry.epoch, status);
+            ReleaseEpoch(entry.epoch);
+          }
+          m_queue.pop_front();
+        }
+        if (m_queue.empty())
+        {
+          m_flushRequested = false;
+        }
+        m_doneCv.notify_all();
+        if (batch.empty())
+        {
+          continue;
+        }
+
+        lock.unlock();
+        std::vector<WfsResult> results = m_sink(batch);
+        lock.lock();
+
+        for (size_t i = 0; i < epochs.size(); ++i)
+        {
+          if (i >= results.size() || !results[i])
+          {
+            RecordFailure(epochs[i], i < results.size()
+                                         ? results[i]
+                                         : WfsResult::Failure(-1, "Write-behind upload not executed"));
+          }
+          ReleaseEpoch(epochs[i]);
+          m_inFlight.erase(batch[i]->name);
+        }
+        m_doneCv.notify_all();
+      }
+    }
+
+    BatchSink m_sink;
+    const std::chrono::milliseconds m_flushInterval;
+    const size_t m_maxBatch;
+    const size_t m_maxQueuedBytes;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workCv;
+    std::condition_variable m_doneCv;
+    std::list<Entry> m_queue;
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+    std::unordered_map<std::string, std::shared_ptr<const WfsFileData>> m_inFlight; // batch being written
+    std::map<uint64_t, size_t> m_pendingByEpoch; // queued or in-flight uploads per flush epoch
+    std::multimap<uint64_t, WfsResult> m_failures;
+    uint64_t m_epoch{0};
+    size_t m_queuedBytes{0};
+    uint64_t m_coalesced{0};
+    bool m_flushRequested{false};
+    bool m_stopping{false};
+    std::thread m_worker;
+  };
+
+} // namespace wfs_client